@@ -0,0 +1,5 @@
+// vanet-npaf with counted heap allocations (--allocStats) and the small block pool (--allocPool)
+// ./ns3 run "vanet-npaf-alloc --allocStats=1 ..."; see vanet-npaf-alloc.h and vanet-npaf-alloc.sh
+
+#define VANET_NPAF_ALLOC_HOOK
+#include "vanet-npaf.cc"
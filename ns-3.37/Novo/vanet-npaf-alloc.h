@@ -0,0 +1,246 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Allocation counting and pooling for vanet-npaf.cc
+
+  When VANET_NPAF_ALLOC_HOOK is defined, global operator new and delete are replaced for
+  the whole program (ns-3 libraries included), so that every heap allocation is counted.
+  AllocationStats reads the counters; the difference between two readings is the malloc
+  traffic in between. The hook costs a call and a header on every allocation, so it is
+  compiled only into vanet-npaf-alloc.cc; in vanet-npaf.cc operator new is the one of the
+  C++ library and AllocationStats and AllocationPool do nothing (AllocationStats::HOOKED
+  is false).
+
+  Packets, tags, headers and events are small and short lived. When the pool is
+  enabled, blocks up to 256 bytes are not returned to malloc when they are deleted, but
+  kept in a free list of their size class (multiples of 16 bytes) and given to the next
+  allocation of that class. Every block has a 16 byte header with its size class, so
+  delete finds the free list without the size and blocks allocated before the pool was
+  enabled are handled too. AllocationPool::Trim returns the free blocks to malloc, e.g.
+  after Simulator::Destroy, so every replication starts with an empty pool.
+
+  This header must be included in exactly one translation unit.
+*/
+
+#ifndef VANET_NPAF_ALLOC_H
+#define VANET_NPAF_ALLOC_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace ns3 {
+
+#ifdef VANET_NPAF_ALLOC_HOOK
+
+/////////////////////////////////////////////
+// struct AllocationStats
+// heap allocations by operator new since the program started
+/////////////////////////////////////////////
+struct AllocationStats
+{
+  uint64_t count; // calls of operator new
+  uint64_t bytes; // bytes requested
+  uint64_t mallocs; // calls of operator new that called malloc (not served by the pool)
+
+  static const bool HOOKED = true; // operator new is counted
+  static AllocationStats Get ();
+  AllocationStats operator- (const AllocationStats &o) const { return {count - o.count, bytes - o.bytes, mallocs - o.mallocs}; };
+};
+
+/////////////////////////////////////////////
+// class AllocationPool
+// free lists of small blocks
+/////////////////////////////////////////////
+class AllocationPool
+{
+public:
+  static void Enable (bool enable) { m_enabled = enable; };
+  static void Trim (); // free blocks are returned to malloc
+
+  static void *Allocate (std::size_t size);
+  static void Free (void *p);
+
+private:
+  static const std::size_t HEADER = 16; // keeps blocks aligned as by malloc
+  static const uint32_t CLASSES = 16; // size classes 16, 32, ... 256 bytes; 0 = not pooled
+
+  struct Block
+  {
+    Block *next;
+  };
+
+  static bool m_enabled;
+  static Block *m_free[CLASSES + 1];
+};
+
+// single threaded program, worker processes have their own counters and pools
+static AllocationStats g_allocations = {0, 0, 0};
+
+bool AllocationPool::m_enabled = false;
+AllocationPool::Block *AllocationPool::m_free[AllocationPool::CLASSES + 1] = {};
+
+AllocationStats
+AllocationStats::Get ()
+{
+  return g_allocations;
+}
+
+void *
+AllocationPool::Allocate (std::size_t size)
+{
+  g_allocations.count++;
+  g_allocations.bytes += size;
+  uint32_t sizeClass = size == 0 ? 1 : (size <= CLASSES * 16 ? (size + 15) / 16 : 0);
+  char *p;
+  if (m_enabled && sizeClass != 0 && m_free[sizeClass] != nullptr)
+    {
+      p = reinterpret_cast<char *> (m_free[sizeClass]) - HEADER;
+      m_free[sizeClass] = m_free[sizeClass]->next;
+    }
+  else
+    {
+      g_allocations.mallocs++;
+      // pooled blocks have the full size of their class, so they can be reused by any size of the class
+      p = static_cast<char *> (std::malloc (HEADER + (sizeClass != 0 ? sizeClass * 16 : size)));
+      if (p == nullptr)
+        {
+          throw std::bad_alloc ();
+        }
+      *reinterpret_cast<uint32_t *> (p) = sizeClass;
+    }
+  return p + HEADER;
+}
+
+void
+AllocationPool::Free (void *p)
+{
+  if (p == nullptr)
+    {
+      return;
+    }
+  char *block = static_cast<char *> (p) - HEADER;
+  uint32_t sizeClass = *reinterpret_cast<uint32_t *> (block);
+  if (m_enabled && sizeClass != 0)
+    {
+      Block *b = static_cast<Block *> (p);
+      b->next = m_free[sizeClass];
+      m_free[sizeClass] = b;
+      return;
+    }
+  std::free (block);
+}
+
+void
+AllocationPool::Trim ()
+{
+  for (uint32_t c = 1; c <= CLASSES; c++)
+    {
+      while (m_free[c] != nullptr)
+        {
+          Block *b = m_free[c];
+          m_free[c] = b->next;
+          std::free (reinterpret_cast<char *> (b) - HEADER);
+        }
+    }
+}
+
+} // namespace ns3
+
+void *
+operator new (std::size_t size)
+{
+  return ns3::AllocationPool::Allocate (size);
+}
+
+void *
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+void *
+operator new (std::size_t size, const std::nothrow_t &) noexcept
+{
+  try
+    {
+      return operator new (size);
+    }
+  catch (...)
+    {
+      return nullptr;
+    }
+}
+
+void *
+operator new[] (std::size_t size, const std::nothrow_t &) noexcept
+{
+  return operator new (size, std::nothrow);
+}
+
+void
+operator delete (void *p) noexcept
+{
+  ns3::AllocationPool::Free (p);
+}
+
+void
+operator delete[] (void *p) noexcept
+{
+  operator delete (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  operator delete (p);
+}
+
+void
+operator delete[] (void *p, std::size_t) noexcept
+{
+  operator delete (p);
+}
+
+#else /* VANET_NPAF_ALLOC_HOOK */
+
+// operator new of the C++ library, nothing is counted or pooled
+struct AllocationStats
+{
+  uint64_t count;
+  uint64_t bytes;
+  uint64_t mallocs;
+
+  static const bool HOOKED = false;
+  static AllocationStats Get () { return {0, 0, 0}; };
+  AllocationStats operator- (const AllocationStats &o) const { return {0, 0, 0}; };
+};
+
+class AllocationPool
+{
+public:
+  static void Enable (bool enable) {};
+  static void Trim () {};
+};
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_ALLOC_HOOK */
+
+#endif /* VANET_NPAF_ALLOC_H */
@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# Heap allocations of one run of the 350 vehicle semafor scenario,
+# with a PPDU copy for every receiver and with one PPDU shared by all receivers,
+# and with the shared PPDU and small blocks reused from the pool
+
+# Name of the script (.cc file in the scratch folder), vanet-npaf with the allocation hook
+PROGRAM_NAME="vanet-npaf-alloc"
+
+# Short run of the scenario, its summary goes to Alloc-*-Summary.csv
+OPTIONS="--scenario=2 --nNodes=350 --nSources=10 --simTime=100 --startupTime=50 --startRngRun=1 --stopRngRun=1 --workers=1 --cacheDir= --csvFileNamePrefix=Alloc --allocStats=1 --channelCutoff=1"
+
+# The table at the end has the numbers for the commit or review:
+# allocations and time of every variant relative to the first one (PPDU copies, malloc)
+TABLE=""
+for VARIANT in "--sharedPpdu=0 --allocPool=0" "--sharedPpdu=1 --allocPool=0" "--sharedPpdu=1 --allocPool=1"
+do
+  echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+  echo x   "./ns3 run \"$PROGRAM_NAME $OPTIONS $VARIANT\""
+  echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+  OUT=$(/usr/bin/time -f "%e s, %M kB" ./ns3 run "$PROGRAM_NAME $OPTIONS $VARIANT" 2>&1 | grep -E "allocations| s, ")
+  echo "$OUT"
+  # "Run 1: <count> allocations, <MB> MB, <mallocs> from malloc" and "<time> s, <rss> kB"
+  TABLE="$TABLE$VARIANT $(echo "$OUT" | awk '/allocations/ { a = $3; m = $7 } / s, / { t = $1; r = $3 } END { print a, m, t, r }')
+"
+done
+
+echo
+printf "%-30s %12s %12s %9s %9s %10s\n" "variant" "allocations" "mallocs" "time [s]" "relative" "RSS [kB]"
+echo -n "$TABLE" | awk '{ if (NR == 1) t0 = $5; printf "%-30s %12s %12s %9s %9.2f %10s\n", $1" "$2, $3, $4, $5, $5 / t0, $6 }'
@@ -0,0 +1,60 @@
+#!/bin/bash
+
+# Scalability benchmark: short fixed-seed runs of the semafor grid (generated mobility)
+# and random waypoint scenarios at 50, 150, 350 and 700 nodes, one run at a time.
+# Resources used by every run go to $RESULT (see --benchmarkFile), which is compared
+# with $BASELINE; "./vanet-npaf-bench.sh save" stores the result as the new baseline.
+# Exit status is 1 when a point is more than $THRESHOLD times slower than the baseline,
+# 3 when there is no baseline (the gate can not pass without one).
+# The MG semafor points use generated Manhattan grid mobility with traffic lights
+# (scenario 3): the semafor trace of scenario 2 exists only for 350 vehicles.
+
+# Name of the script (.cc file in the scratch folder)
+PROGRAM_NAME="vanet-npaf"
+
+RESULT="vanet-npaf-bench.csv"
+BASELINE="scratch/vanet-npaf-bench-baseline.csv"
+THRESHOLD="1.10"
+
+# Fixed seed, no cache (runs are always simulated), no progress records
+OPTIONS="--nSources=10 --simTime=30 --startupTime=20 --startRngRun=1 --stopRngRun=1 --workers=1 --cacheDir= --progressDir= --csvFileNamePrefix=Bench --benchmarkFile=$RESULT"
+
+rm -f $RESULT
+for SCENARIO in 3 0
+do
+  for NODES in 50 150 350 700
+  do
+    echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+    echo x   "./ns3 run \"$PROGRAM_NAME $OPTIONS --scenario=$SCENARIO --nNodes=$NODES\""
+    echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+    ./ns3 run "$PROGRAM_NAME $OPTIONS --scenario=$SCENARIO --nNodes=$NODES" > /dev/null || exit 2
+  done
+done
+
+if [ "$1" == "save" ]
+then
+  cp $RESULT $BASELINE
+  echo "Baseline saved to $BASELINE"
+  exit 0
+fi
+if [ ! -f $BASELINE ]
+then
+  echo "No baseline $BASELINE, results are in $RESULT; run \"$0 save\" on the reference version first"
+  exit 3
+fi
+
+# Points are matched by scenario, routing protocol and number of nodes; a different number
+# of events means that results of the run changed, not only its speed
+awk -F, -v threshold=$THRESHOLD '
+  FNR == 1 { next }
+  NR == FNR { wall[$2","$3","$4] = $7; rate[$2","$3","$4] = $12; rss[$2","$3","$4] = $13; events[$2","$3","$4] = $11; next }
+  {
+    key = $2","$3","$4
+    if (!(key in wall)) { printf "scenario %s routing %s nodes %5s: not in the baseline\n", $2, $3, $4; next }
+    ratio = $7 / wall[key]
+    printf "scenario %s routing %s nodes %5s: wall %8.2f s (%5.2fx), events/s %5.2fx, peak RSS %5.2fx%s%s\n",
+           $2, $3, $4, $7, ratio, $12 / rate[key], $13 / rss[key],
+           ($11 != events[key] ? ", EVENTS DIFFER" : ""), (ratio > threshold ? ", SLOWER" : "")
+    if (ratio > threshold) slower = 1
+  }
+  END { exit slower }' $BASELINE $RESULT
@@ -0,0 +1,220 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Result cache for vanet-npaf.cc
+
+  ResultCache keeps the result of every finished run in its own file, named by a hash
+  of the program version, all simulation parameters and RngRun. A run that is
+  already in the cache is not simulated again, so a sweep that was stopped continues
+  where it stopped, and different sweeps share the configurations they have in common.
+
+  The version is built from the executable and the ns-3 libraries it uses (their
+  paths, sizes and modification times), so every rebuild starts with an empty cache.
+  It can be given explicitly (--cacheVersion) to keep results of an older build.
+  Input files (mobility traces) are part of the parameters through GetFileVersion, a
+  hash of their contents, so a regenerated trace is simulated again.
+*/
+
+#ifndef VANET_NPAF_CACHE_H
+#define VANET_NPAF_CACHE_H
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ns3/core-module.h"
+#include "vanet-npaf-farm.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class ResultCache
+// results of finished runs, one file per run
+/////////////////////////////////////////////
+class ResultCache
+{
+public:
+  ResultCache (std::string dir, std::string version = ""); // empty dir disables the cache, empty version = version of this build
+
+  bool IsEnabled () const { return !m_dir.empty (); };
+  bool Lookup (const std::string &parameters, uint64_t rngRun, RunResult &r) const; // true if the run is in the cache
+  void Store (const std::string &parameters, const RunResult &r) const;
+
+  static std::string GetBuildVersion ();
+  static std::string GetFileVersion (const std::string &fileName); // hash of the contents, "none" if it can not be read
+
+private:
+  static uint64_t Hash (const std::string &s, uint64_t h = 14695981039346656037ULL); // FNV-1a
+  std::string GetFileName (const std::string &parameters, uint64_t rngRun) const;
+
+  std::string m_dir;
+  std::string m_version;
+};
+
+ResultCache::ResultCache (std::string dir, std::string version)
+  : m_dir (dir),
+    m_version (version)
+{
+  if (!IsEnabled ())
+    {
+      return;
+    }
+  if (m_version.empty ())
+    {
+      m_version = GetBuildVersion ();
+    }
+  NS_ABORT_MSG_IF (mkdir (m_dir.c_str (), 0755) != 0 && errno != EEXIST, "Can not create cache directory " << m_dir);
+}
+
+uint64_t
+ResultCache::Hash (const std::string &s, uint64_t h)
+{
+  for (std::string::const_iterator c = s.begin (); c != s.end (); ++c)
+    {
+      h ^= (unsigned char) *c;
+      h *= 1099511628211ULL;
+    }
+  return h;
+}
+
+std::string
+ResultCache::GetBuildVersion ()
+{
+  // executable and every ns-3 library mapped into this process
+  std::set<std::string> files;
+  char exe[4096];
+  ssize_t n = readlink ("/proc/self/exe", exe, sizeof (exe) - 1);
+  if (n > 0)
+    {
+      files.insert (std::string (exe, n));
+    }
+  std::ifstream maps ("/proc/self/maps");
+  std::string line;
+  while (std::getline (maps, line))
+    {
+      std::string::size_type path = line.find ('/');
+      if (path != std::string::npos && line.find ("libns3", path) != std::string::npos)
+        {
+          files.insert (line.substr (path));
+        }
+    }
+
+  uint64_t h = Hash ("");
+  for (std::set<std::string>::const_iterator f = files.begin (); f != files.end (); ++f)
+    {
+      struct stat st;
+      if (stat (f->c_str (), &st) == 0)
+        {
+          h = Hash (*f + " " + std::to_string (st.st_size) + " " + std::to_string (st.st_mtime) + "\n", h);
+        }
+    }
+  std::ostringstream ss;
+  ss << std::hex << std::setw (16) << std::setfill ('0') << h;
+  return ss.str ();
+}
+
+std::string
+ResultCache::GetFileVersion (const std::string &fileName)
+{
+  // every experiment of a sweep asks for the same trace, it is read only once per process
+  static std::map<std::string, std::string> versions; // by name, size and modification time
+  struct stat st;
+  if (stat (fileName.c_str (), &st) != 0)
+    {
+      return "none";
+    }
+  std::string key = fileName + " " + std::to_string (st.st_size) + " " + std::to_string (st.st_mtime);
+  std::map<std::string, std::string>::const_iterator v = versions.find (key);
+  if (v != versions.end ())
+    {
+      return v->second;
+    }
+  std::ifstream file (fileName.c_str (), std::ifstream::binary);
+  uint64_t h = Hash ("");
+  std::string block (1 << 20, '\0');
+  while (file.read (&block[0], block.size ()) || file.gcount () > 0)
+    {
+      h = Hash (block.substr (0, file.gcount ()), h);
+    }
+  std::ostringstream ss;
+  ss << std::hex << std::setw (16) << std::setfill ('0') << h;
+  versions[key] = ss.str ();
+  return ss.str ();
+}
+
+std::string
+ResultCache::GetFileName (const std::string &parameters, uint64_t rngRun) const
+{
+  uint64_t h = Hash (m_version + "\n" + parameters + "\nRngRun=" + std::to_string (rngRun));
+  std::ostringstream ss;
+  ss << m_dir << "/" << std::hex << std::setw (16) << std::setfill ('0') << h << ".run";
+  return ss.str ();
+}
+
+bool
+ResultCache::Lookup (const std::string &parameters, uint64_t rngRun, RunResult &r) const
+{
+  if (!IsEnabled ())
+    {
+      return false;
+    }
+  std::ifstream file (GetFileName (parameters, rngRun).c_str ());
+  std::string version;
+  std::string storedParameters;
+  std::string result;
+  if (!std::getline (file, version) || !std::getline (file, storedParameters) || !std::getline (file, result))
+    {
+      return false;
+    }
+  // hash collisions are not trusted
+  return version == m_version && storedParameters == parameters
+         && DeserializeRunResult (result, r) && r.rngRun == rngRun;
+}
+
+void
+ResultCache::Store (const std::string &parameters, const RunResult &r) const
+{
+  if (!IsEnabled ())
+    {
+      return;
+    }
+  // written under a temporary name and renamed, so an interrupted program never leaves half a file
+  std::string fileName = GetFileName (parameters, r.rngRun);
+  std::string tmpName = fileName + ".tmp" + std::to_string (getpid ());
+  std::ofstream file (tmpName.c_str (), std::ofstream::out | std::ofstream::trunc);
+  file << m_version << "\n" << parameters << "\n" << SerializeRunResult (r) << "\n";
+  file.close ();
+  if (!file || std::rename (tmpName.c_str (), fileName.c_str ()) != 0)
+    {
+      NS_LOG_UNCOND ("Can not store result of run " << r.rngRun << " in " << fileName);
+      std::remove (tmpName.c_str ());
+    }
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_CACHE_H */
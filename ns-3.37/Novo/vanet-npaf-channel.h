@@ -0,0 +1,535 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Wifi channel with cutoff distance for vanet-npaf.cc
+
+  YansWifiChannel computes the loss to every PHY on the channel and schedules a receive
+  event for each of them, although PHYs drop signals below their sensitivity as soon as
+  they arrive. CutoffWifiChannel finds the distance at which the received power falls
+  below the lowest sensitivity (from the loss model, once for every transmit power) and
+  delivers a transmission only to PHYs inside that distance. PHYs are kept in a grid of
+  square cells, so only a few cells around the sender are searched.
+
+  Receivers inside the cutoff get the same events as from YansWifiChannel, in the same
+  order, so results should not change. This holds only for a loss model that is
+  deterministic and grows with distance (Friis, TwoRayGround, LogDistance, ItuR1411Los)
+  and for nodes on the ground (z = 0); with random fading YansWifiChannel must be used,
+  since skipped receivers would not draw their random numbers.
+
+  The grid is updated from mobility: a node is moved to its new cell at every course
+  change. Between course changes nodes can leave their cells, so the search radius is
+  extended by the distance the fastest node could have travelled since the grid was
+  built, and the grid is rebuilt when that becomes a quarter of the cutoff.
+
+  Received power of all receivers of a transmission is computed by BatchPathLoss when
+  the loss model is supported; the cutoff can be turned off, e.g. with fading.
+
+  YansWifiChannel gives every receiver its own copy of the PPDU. Receivers of non-HT
+  PPDUs (802.11p) only read them, and the packet inside is shared by the copies anyway
+  (ns-3 packets are copy-on-write), so with sharedPpdu all receivers get the sender's
+  PPDU. The sender changes its PPDU only when a transmission is cut off (channel switch
+  or PHY turned off), which vanet-npaf.cc never does.
+
+  With the position cache, positions of receivers (and of the sender) for BatchPathLoss
+  are taken from PositionCache, updated at course changes, instead of from mobility
+  models. Propagation delay with ConstantSpeedPropagationDelayModel is computed from the
+  distances BatchPathLoss has already computed.
+
+  Sleeping PHYs (parked vehicles) get no receive events. YansWifiPhy would drop them
+  too, but only after adding the signal to its interference, so a PHY that wakes up
+  during a transmission does not see it as interference here.
+
+  YansWifiChannel::Send is not virtual and YansWifiPhy calls it through a pointer to
+  YansWifiChannel, so the channel alone is never used for sending. CutoffWifiPhy is a
+  YansWifiPhy that sends through CutoffWifiChannel::Send when it is on such a channel,
+  and CutoffWifiPhyHelper installs it instead of YansWifiPhy.
+*/
+
+#ifndef VANET_NPAF_CHANNEL_H
+#define VANET_NPAF_CHANNEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/wifi-module.h"
+#include "vanet-npaf-pathloss.h"
+#include "vanet-npaf-position.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class CutoffWifiChannel
+// YansWifiChannel that does not deliver transmissions beyond the range of sensitivity
+/////////////////////////////////////////////
+class CutoffWifiChannel : public YansWifiChannel
+{
+public:
+  static TypeId GetTypeId ();
+  CutoffWifiChannel ();
+
+  static Ptr<CutoffWifiChannel> CreateFrom (Ptr<YansWifiChannel> channel); // the same loss and delay models
+  void SetCutoff (bool cutoff) { m_useCutoff = cutoff; }; // false = deliver to all receivers
+  void SetLossTable (double step, double range) { m_batch.SetTable (step, range); }; // see BatchPathLoss
+  void SetSharedPpdu (bool shared) { m_sharedPpdu = shared; }; // false = copy for every receiver, as YansWifiChannel
+  void SetPositionCache (bool cache) { m_usePositionCache = cache; }; // see PositionCache
+  void Send (Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, double txPowerDbm) const; // called by CutoffWifiPhy
+
+private:
+  struct Receiver
+  {
+    Ptr<YansWifiPhy> phy;
+    Ptr<MobilityModel> mobility;
+    uint32_t node; // context of receive event
+    uint32_t cell;
+  };
+
+  void Setup () const; // receivers in the order of YansWifiChannel, called when PHYs are added
+  void Build (double cellSize) const; // puts every receiver to its cell
+  uint32_t GetCell (const Vector &pos) const;
+  void CourseChange (Ptr<const MobilityModel> mobility) const;
+  double GetCutoff (double maxLossDb) const; // distance where loss reaches maxLossDb, infinity if never
+  static void Receive (Ptr<YansWifiPhy> phy, Ptr<const WifiPpdu> ppdu, double rxPowerDbm);
+
+  Ptr<PropagationLossModel> m_loss;
+  Ptr<PropagationDelayModel> m_delay;
+  double m_delaySpeed; // [m/s] of ConstantSpeedPropagationDelayModel, 0 = other delay model
+  BatchPathLoss m_batch; // first model of m_loss, if supported
+  bool m_useCutoff;
+  bool m_sharedPpdu;
+  bool m_usePositionCache;
+  mutable PositionCache m_positions; // receivers in the same order as m_receivers
+  mutable bool m_positionsValid; // cache is used and supports mobility models of all receivers
+  mutable std::vector<Receiver> m_receivers;
+  mutable std::map<const MobilityModel *, uint32_t> m_index; // receiver of a mobility model
+  mutable double m_minSensitivity; // [dBm] lowest sensitivity less antenna gain
+  mutable std::map<double, double> m_cutoff; // [m] by max loss [dB]
+
+  // grid of cells
+  mutable std::vector<std::vector<uint32_t> > m_cells; // receivers in each cell
+  mutable double m_cellSize; // [m]
+  mutable double m_minX; // [m] lower left corner
+  mutable double m_minY;
+  mutable uint32_t m_columns;
+  mutable uint32_t m_rows;
+  mutable double m_builtAt; // [s]
+  mutable double m_maxSpeed; // [m/s] highest speed seen
+
+  // receivers of the current transmission, structure of arrays for BatchPathLoss
+  mutable std::vector<uint32_t> m_candidates;
+  mutable std::vector<double> m_x;
+  mutable std::vector<double> m_y;
+  mutable std::vector<double> m_z;
+  mutable std::vector<double> m_rxPowerDbm;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (CutoffWifiChannel);
+
+TypeId
+CutoffWifiChannel::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::CutoffWifiChannel")
+    .SetParent<YansWifiChannel> ()
+    .SetGroupName ("Wifi")
+    .AddConstructor<CutoffWifiChannel> ();
+  return tid;
+}
+
+CutoffWifiChannel::CutoffWifiChannel ()
+  : m_delaySpeed (0.0),
+    m_useCutoff (true),
+    m_sharedPpdu (true),
+    m_usePositionCache (false),
+    m_positionsValid (false),
+    m_minSensitivity (0.0),
+    m_cellSize (0.0),
+    m_minX (0.0),
+    m_minY (0.0),
+    m_columns (0),
+    m_rows (0),
+    m_builtAt (0.0),
+    m_maxSpeed (0.0)
+{
+}
+
+Ptr<CutoffWifiChannel>
+CutoffWifiChannel::CreateFrom (Ptr<YansWifiChannel> channel)
+{
+  PointerValue loss;
+  PointerValue delay;
+  channel->GetAttribute ("PropagationLossModel", loss);
+  channel->GetAttribute ("PropagationDelayModel", delay);
+  Ptr<CutoffWifiChannel> cutoff = CreateObject<CutoffWifiChannel> ();
+  cutoff->m_loss = loss.Get<PropagationLossModel> ();
+  cutoff->m_delay = delay.Get<PropagationDelayModel> ();
+  cutoff->SetPropagationLossModel (cutoff->m_loss);
+  cutoff->SetPropagationDelayModel (cutoff->m_delay);
+  cutoff->m_batch.Configure (cutoff->m_loss);
+  if (cutoff->m_delay->GetInstanceTypeId ().GetName () == "ns3::ConstantSpeedPropagationDelayModel")
+    {
+      DoubleValue speed;
+      cutoff->m_delay->GetAttribute ("Speed", speed);
+      cutoff->m_delaySpeed = speed.Get ();
+    }
+  return cutoff;
+}
+
+void
+CutoffWifiChannel::Setup () const
+{
+  m_receivers.clear ();
+  m_index.clear ();
+  m_positions.Clear ();
+  m_positionsValid = m_usePositionCache;
+  m_minSensitivity = std::numeric_limits<double>::max ();
+  for (std::size_t i = 0; i < GetNDevices (); i++)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (GetDevice (i));
+      Receiver r;
+      r.phy = DynamicCast<YansWifiPhy> (device->GetPhy ());
+      r.mobility = r.phy->GetMobility ();
+      NS_ABORT_MSG_IF (r.mobility == 0, "CutoffWifiChannel needs mobility of every node");
+      r.node = device->GetNode ()->GetId ();
+      r.cell = 0;
+      m_index[PeekPointer (r.mobility)] = m_receivers.size ();
+      r.mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&CutoffWifiChannel::CourseChange, this));
+      m_minSensitivity = std::min (m_minSensitivity, r.phy->GetRxSensitivity () - r.phy->GetRxGain ());
+      m_positionsValid = m_positionsValid && PositionCache::IsSupported (r.mobility);
+      m_receivers.push_back (r);
+    }
+  if (m_positionsValid)
+    {
+      for (std::vector<Receiver>::const_iterator r = m_receivers.begin (); r != m_receivers.end (); ++r)
+        {
+          m_positions.Add (r->mobility);
+        }
+    }
+  else if (m_usePositionCache)
+    {
+      NS_LOG_UNCOND ("Position cache does not support mobility models of all nodes, positions are taken from the models");
+      m_positions.Clear ();
+    }
+  m_cellSize = 0.0; // grid is built by the next Send
+}
+
+uint32_t
+CutoffWifiChannel::GetCell (const Vector &pos) const
+{
+  // nodes that left the area of the grid are in the border cells
+  int64_t column = std::floor ((pos.x - m_minX) / m_cellSize);
+  int64_t row = std::floor ((pos.y - m_minY) / m_cellSize);
+  column = std::min<int64_t> (std::max<int64_t> (column, 0), m_columns - 1);
+  row = std::min<int64_t> (std::max<int64_t> (row, 0), m_rows - 1);
+  return row * m_columns + column;
+}
+
+void
+CutoffWifiChannel::Build (double cellSize) const
+{
+  m_minX = m_minY = std::numeric_limits<double>::max ();
+  double maxX = -std::numeric_limits<double>::max ();
+  double maxY = -std::numeric_limits<double>::max ();
+  std::vector<Vector> pos;
+  for (std::vector<Receiver>::const_iterator r = m_receivers.begin (); r != m_receivers.end (); ++r)
+    {
+      pos.push_back (r->mobility->GetPosition ());
+      m_minX = std::min (m_minX, pos.back ().x);
+      m_minY = std::min (m_minY, pos.back ().y);
+      maxX = std::max (maxX, pos.back ().x);
+      maxY = std::max (maxY, pos.back ().y);
+      m_maxSpeed = std::max (m_maxSpeed, r->mobility->GetVelocity ().GetLength ());
+    }
+  // not more than about 256 x 256 cells, whatever the cutoff
+  m_cellSize = std::max (cellSize, std::max (maxX - m_minX, maxY - m_minY) / 256);
+  m_columns = std::floor ((maxX - m_minX) / m_cellSize) + 1;
+  m_rows = std::floor ((maxY - m_minY) / m_cellSize) + 1;
+  m_cells.assign (m_columns * m_rows, std::vector<uint32_t> ());
+  for (uint32_t i = 0; i < m_receivers.size (); i++)
+    {
+      m_receivers[i].cell = GetCell (pos[i]);
+      m_cells[m_receivers[i].cell].push_back (i);
+    }
+  m_builtAt = Simulator::Now ().GetSeconds ();
+}
+
+void
+CutoffWifiChannel::CourseChange (Ptr<const MobilityModel> mobility) const
+{
+  m_maxSpeed = std::max (m_maxSpeed, mobility->GetVelocity ().GetLength ());
+  std::map<const MobilityModel *, uint32_t>::const_iterator i = m_index.find (PeekPointer (mobility));
+  if (i == m_index.end ())
+    {
+      return;
+    }
+  if (m_positionsValid)
+    {
+      m_positions.Update (i->second);
+    }
+  if (m_cellSize == 0.0)
+    {
+      return;
+    }
+  // node may also jump (new position from a trace), so it is moved to its cell now
+  Receiver &r = m_receivers[i->second];
+  uint32_t cell = GetCell (mobility->GetPosition ());
+  if (cell != r.cell)
+    {
+      std::vector<uint32_t> &old = m_cells[r.cell];
+      old.erase (std::find (old.begin (), old.end (), i->second));
+      m_cells[cell].push_back (i->second);
+      r.cell = cell;
+    }
+}
+
+double
+CutoffWifiChannel::GetCutoff (double maxLossDb) const
+{
+  std::map<double, double>::const_iterator c = m_cutoff.find (maxLossDb);
+  if (c != m_cutoff.end ())
+    {
+      return c->second;
+    }
+  // loss grows with distance: double the distance until the loss is too high, then bisect
+  Ptr<MobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<MobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0.0, 0.0, 0.0));
+  double lo = 0.0;
+  double hi = 1.0;
+  double cutoff = std::numeric_limits<double>::infinity ();
+  for (; hi < 1e7; hi *= 2)
+    {
+      b->SetPosition (Vector (hi, 0.0, 0.0));
+      if (-m_loss->CalcRxPower (0.0, a, b) > maxLossDb)
+        {
+          break;
+        }
+      lo = hi;
+    }
+  if (hi < 1e7)
+    {
+      while (hi - lo > 0.01)
+        {
+          double d = (lo + hi) / 2;
+          b->SetPosition (Vector (d, 0.0, 0.0));
+          (-m_loss->CalcRxPower (0.0, a, b) > maxLossDb ? hi : lo) = d;
+        }
+      cutoff = hi;
+    }
+  m_cutoff[maxLossDb] = cutoff;
+  NS_LOG_UNCOND ("Channel cutoff distance " << cutoff << " m for max loss " << maxLossDb << " dB");
+  return cutoff;
+}
+
+void
+CutoffWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, double txPowerDbm) const
+{
+  if (m_receivers.size () != GetNDevices ())
+    {
+      Setup ();
+    }
+  Ptr<MobilityModel> senderMobility = sender->GetMobility ();
+  NS_ASSERT (senderMobility != 0);
+  bool cached = m_positionsValid && m_batch.IsSupported ();
+  Vector from;
+  if (cached)
+    {
+      m_positions.Refresh ();
+      from = m_positions.GetPosition (m_index.find (PeekPointer (senderMobility))->second);
+    }
+  else
+    {
+      from = senderMobility->GetPosition ();
+    }
+
+  std::vector<uint32_t> &candidates = m_candidates;
+  candidates.clear ();
+  double cutoff = std::numeric_limits<double>::infinity ();
+  if (m_useCutoff)
+    {
+      double threshold = m_minSensitivity + RatioToDb (ppdu->GetTransmissionChannelWidth () / 20.0);
+      cutoff = GetCutoff (txPowerDbm - threshold);
+    }
+  if (std::isinf (cutoff))
+    {
+      for (uint32_t i = 0; i < m_receivers.size (); i++)
+        {
+          candidates.push_back (i);
+        }
+    }
+  else
+    {
+      double now = Simulator::Now ().GetSeconds ();
+      if (m_cellSize == 0.0 || m_maxSpeed * (now - m_builtAt) > 0.25 * m_cellSize)
+        {
+          Build (cutoff);
+        }
+      // receivers may have moved away from their cells since the grid was built
+      double range = cutoff + m_maxSpeed * (now - m_builtAt);
+      uint32_t first = GetCell (Vector (from.x - range, from.y - range, 0.0));
+      uint32_t last = GetCell (Vector (from.x + range, from.y + range, 0.0));
+      for (uint32_t row = first / m_columns; row <= last / m_columns; row++)
+        {
+          for (uint32_t column = first % m_columns; column <= last % m_columns; column++)
+            {
+              const std::vector<uint32_t> &cell = m_cells[row * m_columns + column];
+              candidates.insert (candidates.end (), cell.begin (), cell.end ());
+            }
+        }
+      // the same order of events as in YansWifiChannel
+      std::sort (candidates.begin (), candidates.end ());
+    }
+  std::vector<uint32_t>::iterator end = std::remove_if (candidates.begin (), candidates.end (), [&] (uint32_t i) {
+    return m_receivers[i].phy == sender || m_receivers[i].phy->GetChannelNumber () != sender->GetChannelNumber ()
+           || m_receivers[i].phy->IsStateSleep ();
+  });
+  candidates.erase (end, candidates.end ());
+
+  uint32_t n = candidates.size ();
+  m_rxPowerDbm.resize (n);
+  if (m_batch.IsSupported ())
+    {
+      m_x.resize (n);
+      m_y.resize (n);
+      m_z.resize (n);
+      if (cached)
+        {
+          const double *x = m_positions.GetX ();
+          const double *y = m_positions.GetY ();
+          const double *z = m_positions.GetZ ();
+          for (uint32_t k = 0; k < n; k++)
+            {
+              m_x[k] = x[candidates[k]];
+              m_y[k] = y[candidates[k]];
+              m_z[k] = z[candidates[k]];
+            }
+        }
+      else
+        {
+          for (uint32_t k = 0; k < n; k++)
+            {
+              Vector pos = m_receivers[candidates[k]].mobility->GetPosition ();
+              m_x[k] = pos.x;
+              m_y[k] = pos.y;
+              m_z[k] = pos.z;
+            }
+        }
+      m_batch.CalcRxPower (txPowerDbm, from, n, m_x.data (), m_y.data (), m_z.data (), m_rxPowerDbm.data ());
+    }
+
+  for (uint32_t k = 0; k < n; k++)
+    {
+      const Receiver &r = m_receivers[candidates[k]];
+      // the same distance and formula as ConstantSpeedPropagationDelayModel
+      Time delay = m_delaySpeed > 0.0 && m_batch.IsSupported () ? Seconds (m_batch.GetDistance ()[k] / m_delaySpeed)
+                                                                : m_delay->GetDelay (senderMobility, r.mobility);
+      double rxPowerDbm;
+      if (m_batch.IsSupported ())
+        {
+          // rest of the chain (fading) in the same order as in YansWifiChannel
+          Ptr<PropagationLossModel> next = m_batch.GetNext ();
+          rxPowerDbm = next == 0 ? m_rxPowerDbm[k] : next->CalcRxPower (m_rxPowerDbm[k], senderMobility, r.mobility);
+        }
+      else
+        {
+          rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, r.mobility);
+        }
+      Ptr<const WifiPpdu> rxPpdu = ppdu;
+      if (!m_sharedPpdu)
+        {
+          rxPpdu = ppdu->Copy ();
+        }
+      Simulator::ScheduleWithContext (r.node, delay, &CutoffWifiChannel::Receive, r.phy, rxPpdu, rxPowerDbm);
+    }
+}
+
+void
+CutoffWifiChannel::Receive (Ptr<YansWifiPhy> phy, Ptr<const WifiPpdu> ppdu, double rxPowerDbm)
+{
+  // as in YansWifiChannel
+  if ((rxPowerDbm + phy->GetRxGain ()) < phy->GetRxSensitivity () + RatioToDb (ppdu->GetTransmissionChannelWidth () / 20.0))
+    {
+      return;
+    }
+  RxPowerWattPerChannelBand rxPowerW;
+  rxPowerW.insert ({std::make_pair (0, 0), DbmToW (rxPowerDbm + phy->GetRxGain ())}); // dummy band for YANS
+  phy->StartReceivePreamble (ppdu, rxPowerW, ppdu->GetTxDuration ());
+}
+
+/////////////////////////////////////////////
+// class CutoffWifiPhy
+// YansWifiPhy that sends through CutoffWifiChannel
+/////////////////////////////////////////////
+class CutoffWifiPhy : public YansWifiPhy
+{
+public:
+  static TypeId GetTypeId ();
+
+  virtual void StartTx (Ptr<const WifiPpdu> ppdu);
+};
+
+NS_OBJECT_ENSURE_REGISTERED (CutoffWifiPhy);
+
+TypeId
+CutoffWifiPhy::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::CutoffWifiPhy")
+    .SetParent<YansWifiPhy> ()
+    .SetGroupName ("Wifi")
+    .AddConstructor<CutoffWifiPhy> ();
+  return tid;
+}
+
+void
+CutoffWifiPhy::StartTx (Ptr<const WifiPpdu> ppdu)
+{
+  Ptr<CutoffWifiChannel> channel = DynamicCast<CutoffWifiChannel> (GetChannel ());
+  if (channel == 0)
+    {
+      YansWifiPhy::StartTx (ppdu);
+      return;
+    }
+  // the same power as YansWifiPhy::StartTx
+  channel->Send (this, ppdu, GetTxPowerForTransmission (ppdu) + GetTxGain ());
+}
+
+/////////////////////////////////////////////
+// class CutoffWifiPhyHelper
+// YansWifiPhyHelper that installs CutoffWifiPhy
+/////////////////////////////////////////////
+class CutoffWifiPhyHelper : public YansWifiPhyHelper
+{
+public:
+  CutoffWifiPhyHelper ();
+};
+
+CutoffWifiPhyHelper::CutoffWifiPhyHelper ()
+{
+  // YansWifiPhyHelper::Create makes the PHY with this factory
+  m_phy.at (0).SetTypeId ("ns3::CutoffWifiPhy");
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_CHANNEL_H */
@@ -0,0 +1,213 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Tabulated error rate model for vanet-npaf.cc
+
+  Error rate models compute chunk success rate for every chunk of every reception:
+  NistErrorRateModel with erfc and pow, TableBasedErrorRateModel (default of
+  YansWifiPhyHelper) by searching its tables and with pow. All our frames use one data
+  mode and one header mode, so TabulatedErrorRateModel computes, once per mode and
+  reception parameters (channel width, guard interval, spatial streams, RX antennas, PPDU
+  field and station), the success rate of one bit from the reference model on a dense
+  grid of SNR in dB:
+
+    L(snr) = ln (CSR (snr, nbits)) / nbits
+
+  and then CSR = exp (nbits * L(snr)), with L interpolated linearly. This is exact for
+  models where CSR = (1 - pe)^nbits (Nist, Yans) and for TableBasedErrorRateModel, which
+  scales its PER from the table frame size in the same way; the table of the reference
+  for frames below SizeThreshold is sampled separately. Outside the grid the reference is
+  used. Every table is checked against the reference for CheckBits bits when it is made
+  (reported with NS_LOG=TabulatedErrorRateModel=info).
+*/
+
+#ifndef VANET_NPAF_ERROR_H
+#define VANET_NPAF_ERROR_H
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/wifi-module.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class TabulatedErrorRateModel
+// chunk success rate interpolated from tables made from a reference model
+/////////////////////////////////////////////
+class TabulatedErrorRateModel : public ErrorRateModel
+{
+public:
+  static TypeId GetTypeId ();
+  TabulatedErrorRateModel ();
+
+private:
+  struct Table
+  {
+    std::vector<double> small; // L for frames below SizeThreshold
+    std::vector<double> large;
+  };
+  // mode uid, channel width, guard interval, spatial streams, RX antennas, PPDU field, station
+  typedef std::tuple<uint32_t, uint16_t, uint16_t, uint8_t, uint8_t, WifiPpduField, uint16_t> TableKey;
+
+  virtual double DoGetChunkSuccessRate (WifiMode mode, const WifiTxVector &txVector, double snr, uint64_t nbits,
+                                        uint8_t numRxAntennas, WifiPpduField field, uint16_t staId) const;
+  const Table &GetTable (WifiMode mode, const WifiTxVector &txVector, uint8_t numRxAntennas,
+                         WifiPpduField field, uint16_t staId) const; // made on first use of the parameters
+  double GetLogBitSuccess (WifiMode mode, const WifiTxVector &txVector, double snrDb, uint64_t nbits,
+                           uint8_t numRxAntennas, WifiPpduField field, uint16_t staId) const; // L from the reference
+
+  std::string m_referenceType;
+  double m_minSnrDb; // grid of SNR
+  double m_maxSnrDb;
+  double m_stepDb;
+  uint32_t m_sizeThreshold; // [bytes]
+  uint32_t m_checkBits;
+  double m_tolerance;
+  mutable Ptr<ErrorRateModel> m_reference;
+  mutable std::map<TableKey, Table> m_tables;
+
+  static LogComponent g_log; // NS_LOG_COMPONENT_DEFINE of vanet-npaf.cc is in the same file
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TabulatedErrorRateModel);
+
+LogComponent TabulatedErrorRateModel::g_log ("TabulatedErrorRateModel", __FILE__);
+
+TypeId
+TabulatedErrorRateModel::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::TabulatedErrorRateModel")
+    .SetParent<ErrorRateModel> ()
+    .SetGroupName ("Wifi")
+    .AddConstructor<TabulatedErrorRateModel> ()
+    .AddAttribute ("Reference", "Error rate model the tables are made from.",
+                   StringValue ("ns3::TableBasedErrorRateModel"),
+                   MakeStringAccessor (&TabulatedErrorRateModel::m_referenceType),
+                   MakeStringChecker ())
+    .AddAttribute ("MinSnr", "Lowest SNR in the tables [dB].",
+                   DoubleValue (-10.0),
+                   MakeDoubleAccessor (&TabulatedErrorRateModel::m_minSnrDb),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("MaxSnr", "Highest SNR in the tables [dB].",
+                   DoubleValue (40.0),
+                   MakeDoubleAccessor (&TabulatedErrorRateModel::m_maxSnrDb),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Step", "Step of SNR in the tables [dB].",
+                   DoubleValue (0.01),
+                   MakeDoubleAccessor (&TabulatedErrorRateModel::m_stepDb),
+                   MakeDoubleChecker<double> (1e-6))
+    .AddAttribute ("SizeThreshold", "Frames below this size [bytes] use the small frame table (as SizeThreshold of TableBasedErrorRateModel).",
+                   UintegerValue (400),
+                   MakeUintegerAccessor (&TabulatedErrorRateModel::m_sizeThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("CheckBits", "Chunk size [bits] for which tables are checked against the reference.",
+                   UintegerValue (8 * 512),
+                   MakeUintegerAccessor (&TabulatedErrorRateModel::m_checkBits),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Tolerance", "Largest difference of success rate from the reference accepted by the check.",
+                   DoubleValue (1e-3),
+                   MakeDoubleAccessor (&TabulatedErrorRateModel::m_tolerance),
+                   MakeDoubleChecker<double> (0.0));
+  return tid;
+}
+
+TabulatedErrorRateModel::TabulatedErrorRateModel ()
+{
+}
+
+double
+TabulatedErrorRateModel::GetLogBitSuccess (WifiMode mode, const WifiTxVector &txVector, double snrDb, uint64_t nbits,
+                                           uint8_t numRxAntennas, WifiPpduField field, uint16_t staId) const
+{
+  double csr = m_reference->GetChunkSuccessRate (mode, txVector, DbToRatio (snrDb), nbits, numRxAntennas, field, staId);
+  // CSR below exp(-700) is taken as exp(-700), so that L stays finite
+  return std::max (std::log (csr), -700.0) / nbits;
+}
+
+const TabulatedErrorRateModel::Table &
+TabulatedErrorRateModel::GetTable (WifiMode mode, const WifiTxVector &txVector, uint8_t numRxAntennas,
+                                   WifiPpduField field, uint16_t staId) const
+{
+  TableKey key (mode.GetUid (), txVector.GetChannelWidth (), txVector.GetGuardInterval (),
+                txVector.GetNss (staId), numRxAntennas, field, staId);
+  std::map<TableKey, Table>::const_iterator t = m_tables.find (key);
+  if (t != m_tables.end ())
+    {
+      return t->second;
+    }
+  if (m_reference == 0)
+    {
+      ObjectFactory factory (m_referenceType);
+      m_reference = factory.Create<ErrorRateModel> ();
+    }
+
+  // probe sizes are the frame sizes of TableBasedErrorRateModel tables
+  uint32_t n = std::ceil ((m_maxSnrDb - m_minSnrDb) / m_stepDb) + 1;
+  Table table;
+  table.small.resize (n);
+  table.large.resize (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      double snrDb = m_minSnrDb + i * m_stepDb;
+      table.small[i] = GetLogBitSuccess (mode, txVector, snrDb, 8 * 32, numRxAntennas, field, staId);
+      table.large[i] = GetLogBitSuccess (mode, txVector, snrDb, 8 * 1458, numRxAntennas, field, staId);
+    }
+  const Table &made = m_tables.insert (std::make_pair (key, table)).first->second;
+
+  // check halfway between grid points, where interpolation error is the largest
+  double maxError = 0.0;
+  for (uint32_t i = 0; i + 1 < n; i++)
+    {
+      double snr = DbToRatio (m_minSnrDb + (i + 0.5) * m_stepDb);
+      double reference = m_reference->GetChunkSuccessRate (mode, txVector, snr, m_checkBits, numRxAntennas, field, staId);
+      double tabulated = DoGetChunkSuccessRate (mode, txVector, snr, m_checkBits, numRxAntennas, field, staId);
+      maxError = std::max (maxError, std::fabs (tabulated - reference));
+    }
+  NS_LOG_INFO ("Error rate table for " << mode.GetUniqueName () << " (" << txVector.GetChannelWidth () << " MHz, field "
+               << field << "): largest difference from " << m_referenceType << " " << maxError << " for " << m_checkBits << " bits");
+  NS_ABORT_MSG_IF (maxError > m_tolerance, "Error rate table for " << mode.GetUniqueName () << " differs from the reference by " << maxError);
+  return made;
+}
+
+double
+TabulatedErrorRateModel::DoGetChunkSuccessRate (WifiMode mode, const WifiTxVector &txVector, double snr, uint64_t nbits,
+                                                uint8_t numRxAntennas, WifiPpduField field, uint16_t staId) const
+{
+  // a table is made for every combination of the parameters the reference depends on
+  const Table &table = GetTable (mode, txVector, numRxAntennas, field, staId);
+  double snrDb = RatioToDb (snr);
+  double index = (snrDb - m_minSnrDb) / m_stepDb;
+  if (!(index >= 0.0) || index >= table.small.size () - 1)
+    {
+      return m_reference->GetChunkSuccessRate (mode, txVector, snr, nbits, numRxAntennas, field, staId);
+    }
+  const std::vector<double> &l = nbits / 8 < m_sizeThreshold ? table.small : table.large;
+  uint32_t k = index;
+  double f = index - k;
+  return std::exp (nbits * (l[k] + f * (l[k + 1] - l[k])));
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_ERROR_H */
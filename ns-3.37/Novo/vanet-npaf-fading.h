@@ -0,0 +1,269 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Fast Nakagami fading for vanet-npaf.cc
+
+  NakagamiPropagationLossModel multiplies received power by a Gamma(m, 1/m) variate,
+  drawn by the Gamma or Erlang random variable (several uniform and normal variates,
+  logarithms and square roots per packet and receiver), and converts dBm to W and back.
+  FastNakagamiPropagationLossModel has the same attributes and the same distribution of
+  received power, but draws one uniform variate from its own stream and takes the fading
+  gain in dB from a table of the inverse distribution function (one table per m).
+
+  Tables are indexed by s = -ln(u) for the lower half of the distribution and by
+  s = -ln(1 - u) for the upper half, so both tails (deep fades and rare peaks) are as
+  accurate as the middle; the gain is interpolated linearly in s.
+*/
+
+#ifndef VANET_NPAF_FADING_H
+#define VANET_NPAF_FADING_H
+
+#include <cmath>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class NakagamiTable
+// inverse distribution function of Nakagami power gain [dB] for one m
+/////////////////////////////////////////////
+class NakagamiTable
+{
+public:
+  NakagamiTable (double m = 1.0);
+
+  double GetGainDb (double u) const; // u from (0, 1)
+
+  static double GammaP (double a, double x); // regularized lower incomplete gamma function
+  static double GammaQ (double a, double x); // 1 - GammaP, accurate for the upper tail
+
+private:
+  double Quantile (double s, bool upper) const; // gain [dB] for u = exp(-s), or 1 - u = exp(-s)
+
+  static const uint32_t N = 4096; // points of each half
+  static constexpr double MAX_S = 40.0; // u below exp(-40) is taken as exp(-40)
+
+  double m_m;
+  double m_minS; // ln 2, the median
+  double m_step;
+  std::vector<double> m_lower; // gain at u = exp(-s)
+  std::vector<double> m_upper; // gain at 1 - u = exp(-s)
+};
+
+NakagamiTable::NakagamiTable (double m)
+  : m_m (m),
+    m_minS (std::log (2.0)),
+    m_step ((MAX_S - std::log (2.0)) / (N - 1)),
+    m_lower (N),
+    m_upper (N)
+{
+  for (uint32_t i = 0; i < N; i++)
+    {
+      m_lower[i] = Quantile (m_minS + i * m_step, false);
+      m_upper[i] = Quantile (m_minS + i * m_step, true);
+    }
+}
+
+double
+NakagamiTable::GammaP (double a, double x)
+{
+  if (x <= 0.0)
+    {
+      return 0.0;
+    }
+  if (x >= a + 1.0)
+    {
+      return 1.0 - GammaQ (a, x);
+    }
+  // series
+  double term = 1.0 / a;
+  double sum = term;
+  for (uint32_t n = 1; n < 1000 && std::fabs (term) > std::fabs (sum) * 1e-16; n++)
+    {
+      term *= x / (a + n);
+      sum += term;
+    }
+  return sum * std::exp (-x + a * std::log (x) - std::lgamma (a));
+}
+
+double
+NakagamiTable::GammaQ (double a, double x)
+{
+  if (x < a + 1.0)
+    {
+      return 1.0 - GammaP (a, x);
+    }
+  // continued fraction (modified Lentz)
+  const double tiny = 1e-300;
+  double b = x + 1.0 - a;
+  double c = 1.0 / tiny;
+  double d = 1.0 / b;
+  double h = d;
+  for (uint32_t i = 1; i < 1000; i++)
+    {
+      double an = -(i * (i - a));
+      b += 2.0;
+      d = an * d + b;
+      d = std::fabs (d) < tiny ? tiny : d;
+      c = b + an / c;
+      c = std::fabs (c) < tiny ? tiny : c;
+      d = 1.0 / d;
+      double delta = d * c;
+      h *= delta;
+      if (std::fabs (delta - 1.0) < 1e-16)
+        {
+          break;
+        }
+    }
+  return h * std::exp (-x + a * std::log (x) - std::lgamma (a));
+}
+
+double
+NakagamiTable::Quantile (double s, bool upper) const
+{
+  // power gain g has Gamma(m, 1/m) distribution, i.e. P(g < y) = GammaP (m, m y);
+  // x = m g is found by bisection on ln x
+  double lo = -700.0;
+  double hi = 7.0;
+  while (upper ? std::log (GammaQ (m_m, std::exp (hi))) > -s : std::log (GammaP (m_m, std::exp (hi))) < -s)
+    {
+      hi += 1.0;
+    }
+  for (uint32_t i = 0; i < 200 && hi - lo > 1e-12; i++)
+    {
+      double mid = (lo + hi) / 2;
+      double x = std::exp (mid);
+      double p = upper ? std::log (GammaQ (m_m, x)) : std::log (GammaP (m_m, x));
+      bool below = upper ? p > -s : p < -s;
+      (below ? lo : hi) = mid;
+    }
+  return 10 * std::log10 (std::exp ((lo + hi) / 2) / m_m);
+}
+
+double
+NakagamiTable::GetGainDb (double u) const
+{
+  bool upper = u > 0.5;
+  double s = upper ? -std::log (1.0 - u) : -std::log (u);
+  const std::vector<double> &table = upper ? m_upper : m_lower;
+  double index = (std::min (std::max (s, m_minS), MAX_S) - m_minS) / m_step;
+  uint32_t k = std::min<uint32_t> (index, N - 2);
+  double f = index - k;
+  return table[k] + f * (table[k + 1] - table[k]);
+}
+
+/////////////////////////////////////////////
+// class FastNakagamiPropagationLossModel
+// Nakagami fading from tables of the inverse distribution function
+/////////////////////////////////////////////
+class FastNakagamiPropagationLossModel : public PropagationLossModel
+{
+public:
+  static TypeId GetTypeId ();
+  FastNakagamiPropagationLossModel ();
+
+private:
+  virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+  virtual int64_t DoAssignStreams (int64_t stream);
+  const NakagamiTable &GetTable (double m) const;
+
+  double m_distance1; // [m]
+  double m_distance2; // [m]
+  double m_m0;
+  double m_m1;
+  double m_m2;
+  Ptr<UniformRandomVariable> m_uniform;
+  static std::map<double, NakagamiTable> m_tables; // by m, shared by all models
+};
+
+std::map<double, NakagamiTable> FastNakagamiPropagationLossModel::m_tables;
+
+NS_OBJECT_ENSURE_REGISTERED (FastNakagamiPropagationLossModel);
+
+TypeId
+FastNakagamiPropagationLossModel::GetTypeId ()
+{
+  // attributes and defaults of NakagamiPropagationLossModel
+  static TypeId tid = TypeId ("ns3::FastNakagamiPropagationLossModel")
+    .SetParent<PropagationLossModel> ()
+    .SetGroupName ("Propagation")
+    .AddConstructor<FastNakagamiPropagationLossModel> ()
+    .AddAttribute ("Distance1", "Beginning of the second distance field. Default is 80m.",
+                   DoubleValue (80.0),
+                   MakeDoubleAccessor (&FastNakagamiPropagationLossModel::m_distance1),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Distance2", "Beginning of the third distance field. Default is 200m.",
+                   DoubleValue (200.0),
+                   MakeDoubleAccessor (&FastNakagamiPropagationLossModel::m_distance2),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("m0", "m0 for distances smaller than Distance1. Default is 1.5.",
+                   DoubleValue (1.5),
+                   MakeDoubleAccessor (&FastNakagamiPropagationLossModel::m_m0),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("m1", "m1 for distances smaller than Distance2. Default is 0.75.",
+                   DoubleValue (0.75),
+                   MakeDoubleAccessor (&FastNakagamiPropagationLossModel::m_m1),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("m2", "m2 for distances greater than Distance2. Default is 0.75.",
+                   DoubleValue (0.75),
+                   MakeDoubleAccessor (&FastNakagamiPropagationLossModel::m_m2),
+                   MakeDoubleChecker<double> ());
+  return tid;
+}
+
+FastNakagamiPropagationLossModel::FastNakagamiPropagationLossModel ()
+{
+  m_uniform = CreateObject<UniformRandomVariable> ();
+}
+
+const NakagamiTable &
+FastNakagamiPropagationLossModel::GetTable (double m) const
+{
+  std::map<double, NakagamiTable>::const_iterator t = m_tables.find (m);
+  if (t == m_tables.end ())
+    {
+      t = m_tables.insert (std::make_pair (m, NakagamiTable (m))).first;
+    }
+  return t->second;
+}
+
+double
+FastNakagamiPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+  double distance = a->GetDistanceFrom (b);
+  double m = distance < m_distance1 ? m_m0 : (distance < m_distance2 ? m_m1 : m_m2);
+  return txPowerDbm + GetTable (m).GetGainDb (m_uniform->GetValue ());
+}
+
+int64_t
+FastNakagamiPropagationLossModel::DoAssignStreams (int64_t stream)
+{
+  m_uniform->SetStream (stream);
+  return 1;
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_FADING_H */
@@ -0,0 +1,405 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Parallel runs for vanet-npaf.cc
+
+  ReplicationFarm spreads simulation runs over a pool of worker processes (one per
+  CPU core by default). Workers are forked once and receive runs one at a time
+  through a pipe, so a worker reads mobility traces only once, like a single
+  process running all runs. With one worker, runs are simulated in the calling
+  process. Every finished run is sent back to the parent as text (see
+  SerializeRunResult) and handed over in the order runs finish; the caller
+  decides in which order results are written.
+
+  A worker that dies (crash, assert, out of memory) is replaced by a new one; its
+  run is reported as failed and the remaining runs go on.
+*/
+
+#ifndef VANET_NPAF_FARM_H
+#define VANET_NPAF_FARM_H
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ns3/core-module.h"
+#include "ns3/npaf-module.h"
+
+#include "vanet-npaf-usage.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// struct RunResult
+// everything the summary file needs from one run
+/////////////////////////////////////////////
+struct RunResult
+{
+  uint64_t rngRun;
+  npaf::RunSummary srs;
+  double simDuration; // [s] wall clock time of the run
+  RunMetrics metrics;
+};
+
+// Calls f for every averaged value of RunSummary that is written to the summary file
+template <typename Avg, typename F>
+void
+ForEachSummaryValue (Avg &a, F f)
+{
+  f (a.throughput);
+  f (a.txPackets);
+  f (a.rxPackets);
+  f (a.lostPackets);
+  f (a.lostRatio);
+  f (a.phyTxPkts);
+  f (a.usefullNetTraffic);
+  f (a.e2eDelayMin);
+  f (a.e2eDelayMax);
+  f (a.e2eDelayAverage);
+  f (a.e2eDelayMedianEstimate);
+  f (a.e2eDelayJitter);
+}
+
+// One line of text, values are written with full precision
+inline std::string
+SerializeRunResult (const RunResult &r)
+{
+  std::ostringstream out;
+  out << std::setprecision (17);
+  out << r.rngRun << " " << r.simDuration << " " << r.srs.numberOfFlows;
+  ForEachSummaryValue (r.srs.aaf, [&out] (auto &v) { out << " " << v; });
+  ForEachSummaryValue (r.srs.aap, [&out] (auto &v) { out << " " << v; });
+  const RunMetrics &m = r.metrics;
+  out << " " << m.setupTime << " " << m.loopTime << " " << m.cpuTime << " " << m.events << " " << m.simTime << " " << m.peakRssMb;
+  return out.str ();
+}
+
+inline bool
+DeserializeRunResult (const std::string &s, RunResult &r)
+{
+  std::istringstream in (s);
+  in >> r.rngRun >> r.simDuration >> r.srs.numberOfFlows;
+  ForEachSummaryValue (r.srs.aaf, [&in] (auto &v) { in >> v; });
+  ForEachSummaryValue (r.srs.aap, [&in] (auto &v) { in >> v; });
+  RunMetrics &m = r.metrics;
+  in >> m.setupTime >> m.loopTime >> m.cpuTime >> m.events >> m.simTime >> m.peakRssMb; // results cached before metrics are not found
+  return !in.fail ();
+}
+
+/////////////////////////////////////////////
+// class ReplicationFarm
+// runs jobs in a pool of forked worker processes
+/////////////////////////////////////////////
+class ReplicationFarm
+{
+public:
+  typedef std::function<std::string (uint64_t job)> WorkFunction; // called in a worker, returns result of the job
+  typedef std::function<void (uint64_t job, const std::string &result)> DoneFunction; // called in the parent for every finished job
+  typedef std::function<bool (uint64_t job)> SkipFunction; // called in the parent before a job is started, true = job is not needed any more
+  typedef std::function<void (uint64_t job, const std::string &reason)> FailFunction; // called in the parent when the worker of a job died
+
+  ReplicationFarm (uint32_t nWorkers = 0); // 0 = one worker per CPU core
+  uint32_t GetNWorkers () const { return m_nWorkers; };
+
+  void Run (const std::vector<uint64_t> &jobs, WorkFunction work, DoneFunction done, SkipFunction skip = nullptr,
+            FailFunction fail = nullptr);
+
+private:
+  struct Worker
+  {
+    pid_t pid;
+    int jobFd; // parent -> worker, job numbers
+    int resultFd; // worker -> parent, results
+    bool busy;
+    uint64_t job; // job in progress
+  };
+
+  static bool WriteAll (int fd, const void *buf, size_t len);
+  static bool ReadAll (int fd, void *buf, size_t len);
+  static void WorkerLoop (int jobFd, int resultFd, WorkFunction work);
+  static Worker StartWorker (const std::vector<Worker> &workers, WorkFunction work); // workers = pipes the new one must close
+  static std::string Reap (pid_t pid); // waits for a dead worker, returns how it died
+
+  uint32_t m_nWorkers;
+};
+
+ReplicationFarm::ReplicationFarm (uint32_t nWorkers)
+  : m_nWorkers (nWorkers)
+{
+  if (m_nWorkers == 0)
+    {
+      long cores = sysconf (_SC_NPROCESSORS_ONLN);
+      m_nWorkers = cores > 0 ? cores : 1;
+    }
+}
+
+bool
+ReplicationFarm::WriteAll (int fd, const void *buf, size_t len)
+{
+  const char *p = static_cast<const char *> (buf);
+  while (len > 0)
+    {
+      ssize_t n = write (fd, p, len);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      p += n;
+      len -= n;
+    }
+  return true;
+}
+
+bool
+ReplicationFarm::ReadAll (int fd, void *buf, size_t len)
+{
+  char *p = static_cast<char *> (buf);
+  while (len > 0)
+    {
+      ssize_t n = read (fd, p, len);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false; // error or EOF
+      p += n;
+      len -= n;
+    }
+  return true;
+}
+
+void
+ReplicationFarm::WorkerLoop (int jobFd, int resultFd, WorkFunction work)
+{
+  uint64_t job;
+  while (ReadAll (jobFd, &job, sizeof (job))) // parent closes the pipe when there are no more jobs
+    {
+      std::string result = work (job);
+      uint64_t len = result.size ();
+      if (!WriteAll (resultFd, &job, sizeof (job)) || !WriteAll (resultFd, &len, sizeof (len))
+          || !WriteAll (resultFd, result.data (), len))
+        {
+          break;
+        }
+    }
+}
+
+ReplicationFarm::Worker
+ReplicationFarm::StartWorker (const std::vector<Worker> &workers, WorkFunction work)
+{
+  int jobPipe[2];
+  int resultPipe[2];
+  NS_ABORT_MSG_IF (pipe (jobPipe) != 0 || pipe (resultPipe) != 0, "Can not create pipes for a worker");
+  std::cout.flush ();
+  std::cerr.flush ();
+  pid_t pid = fork ();
+  NS_ABORT_MSG_IF (pid < 0, "Can not start a worker");
+  if (pid == 0)
+    {
+      // worker: pipes of the other workers must be closed, otherwise they never see EOF
+      for (std::vector<Worker>::const_iterator w = workers.begin (); w != workers.end (); ++w)
+        {
+          if (w->jobFd >= 0)
+            {
+              close (w->jobFd);
+            }
+          if (w->resultFd >= 0)
+            {
+              close (w->resultFd);
+            }
+        }
+      close (jobPipe[1]);
+      close (resultPipe[0]);
+      WorkerLoop (jobPipe[0], resultPipe[1], work);
+      std::cout.flush ();
+      std::cerr.flush ();
+      _exit (0);
+    }
+  close (jobPipe[0]);
+  close (resultPipe[1]);
+  Worker w = { pid, jobPipe[1], resultPipe[0], false, 0 };
+  return w;
+}
+
+std::string
+ReplicationFarm::Reap (pid_t pid)
+{
+  int status = 0;
+  if (waitpid (pid, &status, 0) != pid)
+    {
+      return "lost";
+    }
+  std::ostringstream reason;
+  if (WIFSIGNALED (status))
+    {
+      reason << "killed by signal " << WTERMSIG (status);
+    }
+  else
+    {
+      reason << "exited with status " << WEXITSTATUS (status);
+    }
+  return reason.str ();
+}
+
+void
+ReplicationFarm::Run (const std::vector<uint64_t> &jobs, WorkFunction work, DoneFunction done, SkipFunction skip,
+                      FailFunction fail)
+{
+  if (m_nWorkers == 1)
+    {
+      // all jobs in this process
+      for (std::vector<uint64_t>::const_iterator job = jobs.begin (); job != jobs.end (); ++job)
+        {
+          if (!skip || !skip (*job))
+            {
+              done (*job, work (*job));
+            }
+        }
+      return;
+    }
+
+  signal (SIGPIPE, SIG_IGN); // a dead worker must not kill the parent
+  std::vector<Worker> workers;
+  uint32_t nWorkers = std::min<uint64_t> (m_nWorkers, jobs.size ());
+  for (uint32_t i = 0; i < nWorkers; i++)
+    {
+      workers.push_back (StartWorker (workers, work));
+    }
+
+  // gives the next needed job to worker i, or lets it exit when there are none;
+  // a worker that died in the meantime is replaced and the job goes to the new one
+  size_t next = 0;
+  uint32_t busy = 0;
+  std::function<void (size_t)> dispatch = [&] (size_t i)
+    {
+      while (skip && next < jobs.size () && skip (jobs[next]))
+        {
+          next++;
+        }
+      if (next == jobs.size ())
+        {
+          close (workers[i].jobFd); // nothing to do, worker exits
+          workers[i].jobFd = -1;
+          return;
+        }
+      uint64_t job = jobs[next];
+      while (!WriteAll (workers[i].jobFd, &job, sizeof (job)))
+        {
+          std::cerr << "Worker " << workers[i].pid << " does not accept jobs (" << Reap (workers[i].pid) << "), starting a new one" << std::endl;
+          close (workers[i].jobFd);
+          close (workers[i].resultFd);
+          workers[i].jobFd = workers[i].resultFd = -1; // numbers may be reused by the new pipes
+          workers[i] = StartWorker (workers, work);
+        }
+      next++;
+      workers[i].job = job;
+      workers[i].busy = true;
+      busy++;
+    };
+
+  // every worker gets its first job, the rest are given to the first free worker
+  for (size_t i = 0; i < workers.size (); i++)
+    {
+      dispatch (i);
+    }
+
+  while (busy > 0)
+    {
+      std::vector<struct pollfd> fds;
+      std::vector<size_t> polled;
+      for (size_t i = 0; i < workers.size (); i++)
+        {
+          if (workers[i].busy)
+            {
+              struct pollfd pfd = { workers[i].resultFd, POLLIN, 0 };
+              fds.push_back (pfd);
+              polled.push_back (i);
+            }
+        }
+      if (poll (fds.data (), fds.size (), -1) < 0)
+        {
+          NS_ABORT_MSG_IF (errno != EINTR, "poll failed while waiting for workers");
+          continue;
+        }
+      for (size_t i = 0; i < fds.size (); i++)
+        {
+          if (fds[i].revents == 0)
+            {
+              continue;
+            }
+          Worker &w = workers[polled[i]];
+          uint64_t job;
+          uint64_t len;
+          std::string result;
+          bool ok = ReadAll (w.resultFd, &job, sizeof (job)) && ReadAll (w.resultFd, &len, sizeof (len));
+          if (ok)
+            {
+              result.resize (len);
+              ok = ReadAll (w.resultFd, &result[0], len);
+            }
+          w.busy = false;
+          busy--;
+          if (ok)
+            {
+              done (job, result);
+            }
+          else
+            {
+              // the job is not simulated again, it would most likely die the same way
+              std::string reason = Reap (w.pid);
+              if (fail)
+                {
+                  fail (w.job, reason);
+                }
+              else
+                {
+                  std::cerr << "Worker " << w.pid << " " << reason << " while simulating job " << w.job << std::endl;
+                }
+              if (w.jobFd >= 0)
+                {
+                  close (w.jobFd);
+                }
+              close (w.resultFd);
+              w.jobFd = w.resultFd = -1; // numbers may be reused by the new pipes
+              w = StartWorker (workers, work);
+            }
+          dispatch (polled[i]);
+        }
+    }
+
+  for (std::vector<Worker>::iterator w = workers.begin (); w != workers.end (); ++w)
+    {
+      close (w->resultFd);
+      waitpid (w->pid, NULL, 0);
+    }
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_FARM_H */
@@ -0,0 +1,357 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Manhattan grid mobility for vanet-npaf.cc
+
+  ManhattanGridMobilityModel moves a vehicle over a square grid of streets, like the
+  SUMO traces 2x2km-21x21streets-2lanes-15mps-9trafficLights, but the movement is
+  generated during the simulation from the node's own random streams. Defaults: 21x21
+  streets 100 m apart, 2 lanes 3.2 m wide in each direction (right-hand traffic) and
+  traffic lights at every 5th interior intersection (9 lights for 21 streets).
+
+  A vehicle drives with constant speed to the stop line of the next intersection, waits
+  there while its light is red, and crosses the intersection straight ahead or turning
+  left or right (never leaving the grid). A new speed is drawn after every intersection.
+  Vehicles do not see each other (no queues or car following). Only the next change of
+  movement of a vehicle is in the event queue.
+*/
+
+#ifndef VANET_NPAF_GRID_H
+#define VANET_NPAF_GRID_H
+
+#include <cmath>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class ManhattanGridMobilityModel
+// vehicle on a grid of streets with traffic lights
+/////////////////////////////////////////////
+class ManhattanGridMobilityModel : public MobilityModel
+{
+public:
+  static TypeId GetTypeId ();
+  ManhattanGridMobilityModel ();
+
+private:
+  virtual void DoInitialize ();
+  virtual void DoDispose ();
+  virtual Vector DoGetPosition () const;
+  virtual void DoSetPosition (const Vector &position);
+  virtual Vector DoGetVelocity () const;
+  virtual int64_t DoAssignStreams (int64_t stream);
+
+  void Place (); // random initial position between two intersections
+  void Drive (); // to the stop line of the next intersection
+  void AtStopLine ();
+  void Cross (); // to the beginning of the next street
+  void AfterCrossing ();
+  void MoveTo (const Vector &target, double speed, void (ManhattanGridMobilityModel::*next) ());
+  Vector LanePoint (bool vertical, int32_t street, int32_t direction, double along) const;
+  double GetGap () const { return m_lanes * m_laneWidth + 1.6; }; // stop line from the middle of intersection
+  double GetRedTime () const; // time until the light for current direction is green, 0 if green or no light
+
+  // grid, set by attributes
+  double m_spacing; // [m] between streets
+  uint32_t m_streets; // in each direction
+  uint32_t m_lanes; // in each direction of a street
+  double m_laneWidth; // [m]
+  uint32_t m_lightEvery; // light at intersections of every n-th street, borders excluded
+  double m_greenTime; // [s] green for horizontal streets, then the same for vertical
+  double m_straightProbability; // go straight at an intersection, otherwise turn
+  Ptr<RandomVariableStream> m_speed; // [m/s] drawn after every intersection
+  Ptr<UniformRandomVariable> m_random; // placement and turns
+
+  // current route
+  bool m_placed;
+  bool m_vertical; // street goes along y axis
+  int32_t m_street; // index of current street
+  int32_t m_direction; // +1 or -1 along the street
+  uint32_t m_lane;
+  int32_t m_next; // index of the next intersection (index of the crossing street)
+  bool m_nextVertical; // street after the intersection
+  int32_t m_nextStreet;
+  int32_t m_nextDirection;
+  double m_currentSpeed;
+  ConstantVelocityHelper m_helper;
+  EventId m_event;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (ManhattanGridMobilityModel);
+
+TypeId
+ManhattanGridMobilityModel::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::ManhattanGridMobilityModel")
+    .SetParent<MobilityModel> ()
+    .SetGroupName ("Mobility")
+    .AddConstructor<ManhattanGridMobilityModel> ()
+    .AddAttribute ("Spacing", "Distance between streets [m].",
+                   DoubleValue (100.0),
+                   MakeDoubleAccessor (&ManhattanGridMobilityModel::m_spacing),
+                   MakeDoubleChecker<double> (1.0))
+    .AddAttribute ("Streets", "Number of streets in each direction.",
+                   UintegerValue (21),
+                   MakeUintegerAccessor (&ManhattanGridMobilityModel::m_streets),
+                   MakeUintegerChecker<uint32_t> (2))
+    .AddAttribute ("Lanes", "Lanes in each direction of a street.",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&ManhattanGridMobilityModel::m_lanes),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("LaneWidth", "Width of a lane [m].",
+                   DoubleValue (3.2),
+                   MakeDoubleAccessor (&ManhattanGridMobilityModel::m_laneWidth),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("LightEvery", "Traffic lights at intersections of every n-th street (0 = no lights).",
+                   UintegerValue (5),
+                   MakeUintegerAccessor (&ManhattanGridMobilityModel::m_lightEvery),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("GreenTime", "Green light for one direction [s].",
+                   DoubleValue (30.0),
+                   MakeDoubleAccessor (&ManhattanGridMobilityModel::m_greenTime),
+                   MakeDoubleChecker<double> (0.1))
+    .AddAttribute ("StraightProbability", "Probability to go straight at an intersection.",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&ManhattanGridMobilityModel::m_straightProbability),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("Speed", "Speed of the vehicle [m/s], drawn after every intersection.",
+                   StringValue ("ns3::NormalRandomVariable[Mean=15.0|Variance=2.25|Bound=3.75]"),
+                   MakePointerAccessor (&ManhattanGridMobilityModel::m_speed),
+                   MakePointerChecker<RandomVariableStream> ());
+  return tid;
+}
+
+ManhattanGridMobilityModel::ManhattanGridMobilityModel ()
+  : m_placed (false),
+    m_vertical (false),
+    m_street (0),
+    m_direction (1),
+    m_lane (0),
+    m_next (0),
+    m_nextVertical (false),
+    m_nextStreet (0),
+    m_nextDirection (1),
+    m_currentSpeed (0.0)
+{
+  m_random = CreateObject<UniformRandomVariable> ();
+}
+
+int64_t
+ManhattanGridMobilityModel::DoAssignStreams (int64_t stream)
+{
+  m_speed->SetStream (stream);
+  m_random->SetStream (stream + 1);
+  return 2;
+}
+
+void
+ManhattanGridMobilityModel::DoInitialize ()
+{
+  if (!m_placed)
+    {
+      Place ();
+    }
+  m_currentSpeed = std::max (1.0, m_speed->GetValue ());
+  Drive ();
+  MobilityModel::DoInitialize ();
+}
+
+void
+ManhattanGridMobilityModel::DoDispose ()
+{
+  m_event.Cancel ();
+  MobilityModel::DoDispose ();
+}
+
+Vector
+ManhattanGridMobilityModel::LanePoint (bool vertical, int32_t street, int32_t direction, double along) const
+{
+  // lanes are on the right side of the street center
+  double offset = (m_lane + 0.5) * m_laneWidth;
+  if (vertical)
+    {
+      return Vector (street * m_spacing + direction * offset, along, 0.0);
+    }
+  return Vector (along, street * m_spacing - direction * offset, 0.0);
+}
+
+void
+ManhattanGridMobilityModel::Place ()
+{
+  m_placed = true;
+  m_vertical = m_random->GetValue () < 0.5;
+  m_street = m_random->GetInteger (0, m_streets - 1);
+  m_direction = m_random->GetValue () < 0.5 ? 1 : -1;
+  m_lane = m_random->GetInteger (0, m_lanes - 1);
+  uint32_t block = m_random->GetInteger (0, m_streets - 2);
+  double along = block * m_spacing + GetGap () + m_random->GetValue () * (m_spacing - 2 * GetGap ());
+  m_helper.SetPosition (LanePoint (m_vertical, m_street, m_direction, along));
+  m_helper.SetVelocity (Vector (0.0, 0.0, 0.0));
+}
+
+void
+ManhattanGridMobilityModel::MoveTo (const Vector &target, double speed, void (ManhattanGridMobilityModel::*next) ())
+{
+  m_helper.Update ();
+  Vector pos = m_helper.GetCurrentPosition ();
+  double distance = CalculateDistance (pos, target);
+  double time = distance / speed;
+  m_helper.SetVelocity (time > 0 ? Vector ((target.x - pos.x) / time, (target.y - pos.y) / time, 0.0) : Vector (0.0, 0.0, 0.0));
+  m_helper.Unpause ();
+  m_event = Simulator::Schedule (Seconds (time), next, this);
+  NotifyCourseChange ();
+}
+
+void
+ManhattanGridMobilityModel::Drive ()
+{
+  Vector pos = m_helper.GetCurrentPosition ();
+  double along = m_vertical ? pos.y : pos.x;
+  // next intersection ahead, the vehicle is always between two intersections
+  m_next = m_direction > 0 ? (int32_t) std::floor (along / m_spacing) + 1 : (int32_t) std::ceil (along / m_spacing) - 1;
+  double stopLine = m_next * m_spacing - m_direction * GetGap ();
+  MoveTo (LanePoint (m_vertical, m_street, m_direction, stopLine), m_currentSpeed, &ManhattanGridMobilityModel::AtStopLine);
+}
+
+double
+ManhattanGridMobilityModel::GetRedTime () const
+{
+  if (m_lightEvery == 0 || m_street % m_lightEvery != 0 || m_next % m_lightEvery != 0
+      || m_street == 0 || m_next == 0 || m_street == (int32_t) m_streets - 1 || m_next == (int32_t) m_streets - 1)
+    {
+      return 0.0;
+    }
+  // horizontal streets have green in the first half of the cycle
+  double phase = std::fmod (Simulator::Now ().GetSeconds (), 2 * m_greenTime);
+  if (!m_vertical)
+    {
+      return phase < m_greenTime ? 0.0 : 2 * m_greenTime - phase;
+    }
+  return phase < m_greenTime ? m_greenTime - phase : 0.0;
+}
+
+void
+ManhattanGridMobilityModel::AtStopLine ()
+{
+  m_helper.Update ();
+  double red = GetRedTime ();
+  if (red > 0)
+    {
+      m_helper.SetVelocity (Vector (0.0, 0.0, 0.0));
+      m_event = Simulator::Schedule (Seconds (red), &ManhattanGridMobilityModel::Cross, this);
+      NotifyCourseChange ();
+      return;
+    }
+  Cross ();
+}
+
+void
+ManhattanGridMobilityModel::Cross ()
+{
+  // straight ahead or turn, the vehicle must stay in the grid
+  int32_t last = m_streets - 1;
+  bool straight = m_next + m_direction >= 0 && m_next + m_direction <= last;
+  std::vector<int32_t> turns; // directions on the crossing street
+  for (int32_t d = -1; d <= 1; d += 2)
+    {
+      if (m_street + d >= 0 && m_street + d <= last)
+        {
+          turns.push_back (d);
+        }
+    }
+  if (straight && (turns.empty () || m_random->GetValue () < m_straightProbability))
+    {
+      m_nextVertical = m_vertical;
+      m_nextStreet = m_street;
+      m_nextDirection = m_direction;
+    }
+  else
+    {
+      m_nextVertical = !m_vertical;
+      m_nextStreet = m_next;
+      m_nextDirection = turns[m_random->GetInteger (0, turns.size () - 1)];
+    }
+  double along = (m_nextVertical == m_vertical ? m_next : m_street) * m_spacing + m_nextDirection * GetGap ();
+  MoveTo (LanePoint (m_nextVertical, m_nextStreet, m_nextDirection, along), m_currentSpeed, &ManhattanGridMobilityModel::AfterCrossing);
+}
+
+void
+ManhattanGridMobilityModel::AfterCrossing ()
+{
+  m_helper.Update ();
+  Vector pos = m_helper.GetCurrentPosition ();
+  m_vertical = m_nextVertical;
+  m_street = m_nextStreet;
+  m_direction = m_nextDirection;
+  // exact position, so that rounding errors do not accumulate
+  m_helper.SetPosition (LanePoint (m_vertical, m_street, m_direction, m_vertical ? pos.y : pos.x));
+  m_currentSpeed = std::max (1.0, m_speed->GetValue ());
+  Drive ();
+}
+
+Vector
+ManhattanGridMobilityModel::DoGetPosition () const
+{
+  if (!m_placed)
+    {
+      // position is needed before initialization, e.g. for the position dump in verbose mode
+      const_cast<ManhattanGridMobilityModel *> (this)->Place ();
+    }
+  m_helper.Update ();
+  return m_helper.GetCurrentPosition ();
+}
+
+void
+ManhattanGridMobilityModel::DoSetPosition (const Vector &position)
+{
+  // vehicle is put on the nearest street, between two intersections
+  m_placed = true;
+  double dx = std::fabs (position.x - std::round (position.x / m_spacing) * m_spacing);
+  double dy = std::fabs (position.y - std::round (position.y / m_spacing) * m_spacing);
+  m_vertical = dx < dy;
+  double across = m_vertical ? position.x : position.y;
+  double along = m_vertical ? position.y : position.x;
+  m_street = std::min<int32_t> (m_streets - 1, std::max<int32_t> (0, std::round (across / m_spacing)));
+  double block = std::min<double> (m_streets - 2, std::max (0.0, std::floor (along / m_spacing)));
+  along = std::min (std::max (along, block * m_spacing + GetGap ()), (block + 1) * m_spacing - GetGap ());
+  m_helper.SetPosition (LanePoint (m_vertical, m_street, m_direction, along));
+  if (m_event.IsRunning ())
+    {
+      m_event.Cancel ();
+      Drive ();
+    }
+  else
+    {
+      NotifyCourseChange ();
+    }
+}
+
+Vector
+ManhattanGridMobilityModel::DoGetVelocity () const
+{
+  return m_helper.GetVelocity ();
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_GRID_H */
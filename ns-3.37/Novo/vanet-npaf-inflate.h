@@ -0,0 +1,681 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Compressed mobility traces for vanet-npaf.cc
+
+  CompressedFileBuf is a stream buffer that reads a gzip file or the first entry of a
+  zip archive and returns the uncompressed text, so a trace can be read with
+  std::getline without unpacking it first. Decompression (DEFLATE, RFC 1951) is done
+  here, ns-3 does not link zlib. Memory use does not depend on the size of the file:
+  32 kB window and small input and output buffers. CRC-32 of the data is checked at
+  the end when the archive stores it.
+*/
+
+#ifndef VANET_NPAF_INFLATE_H
+#define VANET_NPAF_INFLATE_H
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class Inflater
+// DEFLATE decoder that produces output in pieces of any size
+/////////////////////////////////////////////
+class Inflater
+{
+public:
+  Inflater (std::istream &in);
+
+  size_t Read (char *out, size_t n); // returns less than n only at the end of data or on error
+  void SetStored (uint64_t size); // data is not compressed, just copy size bytes
+  bool IsFinished () const { return m_finished; };
+  bool IsFailed () const { return m_failed; };
+  uint32_t GetCrc () const { return ~m_crc; }; // CRC-32 of data returned so far
+  uint64_t GetSize () const { return m_size; }; // uncompressed bytes returned so far
+
+  int ReadByte (); // next byte of input after DEFLATE data (trailers), -1 at end
+
+private:
+  // canonical Huffman code: number of codes of each length and symbols ordered by code
+  struct Huffman
+  {
+    uint16_t count[16];
+    uint16_t symbol[288];
+  };
+
+  bool Fill (); // input buffer
+  bool NeedBits (uint32_t n);
+  uint32_t Bits (uint32_t n);
+  int Decode (const Huffman &h);
+  static bool Build (Huffman &h, const uint8_t *lengths, uint32_t n);
+  bool StartBlock ();
+  bool DynamicTables ();
+  void Output (uint8_t b, char *out, size_t &produced);
+  void Fail () { m_failed = true; m_finished = true; };
+
+  std::istream &m_in;
+  std::vector<uint8_t> m_inBuf;
+  size_t m_inPos;
+  size_t m_inLen;
+  uint32_t m_bitBuf; // bits not used yet, least significant first
+  uint32_t m_bitCnt;
+
+  std::vector<uint8_t> m_window; // last 32 kB of output, for back references
+  uint32_t m_wpos;
+
+  enum Block
+  {
+    NONE, // between blocks
+    STORED,
+    HUFFMAN,
+    RAW // whole input is not compressed (SetStored)
+  };
+  Block m_block;
+  bool m_last; // current block is the last one
+  uint64_t m_storedLeft;
+  uint32_t m_copyLen; // back reference in progress
+  uint32_t m_copyDist;
+  Huffman m_lencode;
+  Huffman m_distcode;
+
+  bool m_finished;
+  bool m_failed;
+  uint32_t m_crc;
+  uint64_t m_size;
+};
+
+Inflater::Inflater (std::istream &in)
+  : m_in (in),
+    m_inBuf (65536),
+    m_inPos (0),
+    m_inLen (0),
+    m_bitBuf (0),
+    m_bitCnt (0),
+    m_window (32768),
+    m_wpos (0),
+    m_block (NONE),
+    m_last (false),
+    m_storedLeft (0),
+    m_copyLen (0),
+    m_copyDist (0),
+    m_finished (false),
+    m_failed (false),
+    m_crc (0xffffffff),
+    m_size (0)
+{
+}
+
+void
+Inflater::SetStored (uint64_t size)
+{
+  m_block = RAW;
+  m_storedLeft = size;
+}
+
+bool
+Inflater::Fill ()
+{
+  if (m_inPos < m_inLen)
+    {
+      return true;
+    }
+  m_in.read ((char *) m_inBuf.data (), m_inBuf.size ());
+  m_inLen = m_in.gcount ();
+  m_inPos = 0;
+  return m_inLen > 0;
+}
+
+int
+Inflater::ReadByte ()
+{
+  // remaining bits of the last byte are dropped, trailers are byte aligned
+  m_bitBuf = 0;
+  m_bitCnt = 0;
+  if (!Fill ())
+    {
+      return -1;
+    }
+  return m_inBuf[m_inPos++];
+}
+
+bool
+Inflater::NeedBits (uint32_t n)
+{
+  while (m_bitCnt < n)
+    {
+      if (!Fill ())
+        {
+          Fail ();
+          return false;
+        }
+      m_bitBuf |= (uint32_t) m_inBuf[m_inPos++] << m_bitCnt;
+      m_bitCnt += 8;
+    }
+  return true;
+}
+
+uint32_t
+Inflater::Bits (uint32_t n)
+{
+  if (n == 0 || !NeedBits (n))
+    {
+      return 0;
+    }
+  uint32_t v = m_bitBuf & ((1u << n) - 1);
+  m_bitBuf >>= n;
+  m_bitCnt -= n;
+  return v;
+}
+
+int
+Inflater::Decode (const Huffman &h)
+{
+  // codes are read bit by bit, most significant bit of the code first
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for (int len = 1; len < 16; len++)
+    {
+      if (m_bitCnt == 0 && !NeedBits (1))
+        {
+          return -1;
+        }
+      code |= m_bitBuf & 1;
+      m_bitBuf >>= 1;
+      m_bitCnt--;
+      int count = h.count[len];
+      if (code - count < first)
+        {
+          return h.symbol[index + (code - first)];
+        }
+      index += count;
+      first += count;
+      first <<= 1;
+      code <<= 1;
+    }
+  Fail (); // code longer than 15 bits
+  return -1;
+}
+
+bool
+Inflater::Build (Huffman &h, const uint8_t *lengths, uint32_t n)
+{
+  std::memset (h.count, 0, sizeof (h.count));
+  for (uint32_t s = 0; s < n; s++)
+    {
+      h.count[lengths[s]]++;
+    }
+  if (h.count[0] == n)
+    {
+      return true; // no codes, e.g. distance code of a block without back references
+    }
+  // over-subscribed code is an error, incomplete code is allowed (single distance code)
+  int left = 1;
+  for (int len = 1; len < 16; len++)
+    {
+      left <<= 1;
+      left -= h.count[len];
+      if (left < 0)
+        {
+          return false;
+        }
+    }
+  uint16_t offs[16];
+  offs[1] = 0;
+  for (int len = 1; len < 15; len++)
+    {
+      offs[len + 1] = offs[len] + h.count[len];
+    }
+  for (uint32_t s = 0; s < n; s++)
+    {
+      if (lengths[s] != 0)
+        {
+          h.symbol[offs[lengths[s]]++] = s;
+        }
+    }
+  return true;
+}
+
+bool
+Inflater::DynamicTables ()
+{
+  static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+  uint32_t nlen = Bits (5) + 257;
+  uint32_t ndist = Bits (5) + 1;
+  uint32_t ncode = Bits (4) + 4;
+  if (m_failed || nlen > 286 || ndist > 30)
+    {
+      return false;
+    }
+  uint8_t lengths[320];
+  std::memset (lengths, 0, sizeof (lengths));
+  for (uint32_t i = 0; i < ncode; i++)
+    {
+      lengths[order[i]] = Bits (3);
+    }
+  Huffman lencode;
+  if (m_failed || !Build (lencode, lengths, 19))
+    {
+      return false;
+    }
+
+  // literal/length and distance code lengths, with run-length codes 16, 17 and 18
+  uint32_t index = 0;
+  while (index < nlen + ndist)
+    {
+      int symbol = Decode (lencode);
+      if (symbol < 0)
+        {
+          return false;
+        }
+      if (symbol < 16)
+        {
+          lengths[index++] = symbol;
+          continue;
+        }
+      uint8_t len = 0;
+      uint32_t repeat;
+      if (symbol == 16)
+        {
+          if (index == 0)
+            {
+              return false;
+            }
+          len = lengths[index - 1];
+          repeat = 3 + Bits (2);
+        }
+      else if (symbol == 17)
+        {
+          repeat = 3 + Bits (3);
+        }
+      else
+        {
+          repeat = 11 + Bits (7);
+        }
+      if (m_failed || index + repeat > nlen + ndist)
+        {
+          return false;
+        }
+      while (repeat--)
+        {
+          lengths[index++] = len;
+        }
+    }
+  if (lengths[256] == 0)
+    {
+      return false; // no end of block code
+    }
+  return Build (m_lencode, lengths, nlen) && Build (m_distcode, lengths + nlen, ndist);
+}
+
+bool
+Inflater::StartBlock ()
+{
+  m_last = Bits (1);
+  uint32_t type = Bits (2);
+  if (m_failed)
+    {
+      return false;
+    }
+  if (type == 0)
+    {
+      // stored block: byte aligned LEN and NLEN
+      m_bitBuf = 0;
+      m_bitCnt = 0;
+      uint32_t len = Bits (16);
+      uint32_t nlen = Bits (16);
+      if (m_failed || len != (~nlen & 0xffff))
+        {
+          return false;
+        }
+      m_storedLeft = len;
+      m_block = STORED;
+      return true;
+    }
+  if (type == 1)
+    {
+      // fixed codes
+      uint8_t lengths[288];
+      std::memset (lengths, 8, 144);
+      std::memset (lengths + 144, 9, 112);
+      std::memset (lengths + 256, 7, 24);
+      std::memset (lengths + 280, 8, 8);
+      Build (m_lencode, lengths, 288);
+      std::memset (lengths, 5, 30);
+      Build (m_distcode, lengths, 30);
+      m_block = HUFFMAN;
+      return true;
+    }
+  if (type == 2 && DynamicTables ())
+    {
+      m_block = HUFFMAN;
+      return true;
+    }
+  return false;
+}
+
+void
+Inflater::Output (uint8_t b, char *out, size_t &produced)
+{
+  static uint32_t table[256];
+  static bool tableReady = false;
+  if (!tableReady)
+    {
+      for (uint32_t i = 0; i < 256; i++)
+        {
+          uint32_t c = i;
+          for (int k = 0; k < 8; k++)
+            {
+              c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+          table[i] = c;
+        }
+      tableReady = true;
+    }
+  m_crc = table[(m_crc ^ b) & 0xff] ^ (m_crc >> 8);
+  m_window[m_wpos] = b;
+  m_wpos = (m_wpos + 1) & 32767;
+  out[produced++] = b;
+  m_size++;
+}
+
+size_t
+Inflater::Read (char *out, size_t n)
+{
+  static const uint16_t lbase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+  static const uint8_t lext[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+  static const uint16_t dbase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                      257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                      8193, 12289, 16385, 24577 };
+  static const uint8_t dext[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+  size_t produced = 0;
+  while (produced < n && !m_finished)
+    {
+      if (m_copyLen > 0)
+        {
+          Output (m_window[(m_wpos - m_copyDist) & 32767], out, produced);
+          m_copyLen--;
+          continue;
+        }
+      switch (m_block)
+        {
+        case NONE:
+          if (m_last)
+            {
+              m_finished = true;
+            }
+          else if (!StartBlock ())
+            {
+              Fail ();
+            }
+          break;
+        case RAW:
+        case STORED:
+          if (m_storedLeft == 0)
+            {
+              m_finished = m_block == RAW;
+              m_block = NONE;
+            }
+          else if (Fill ())
+            {
+              Output (m_inBuf[m_inPos++], out, produced);
+              m_storedLeft--;
+            }
+          else
+            {
+              Fail ();
+            }
+          break;
+        case HUFFMAN:
+          {
+            int symbol = Decode (m_lencode);
+            if (symbol < 0)
+              {
+                Fail ();
+              }
+            else if (symbol < 256)
+              {
+                Output (symbol, out, produced);
+              }
+            else if (symbol == 256)
+              {
+                m_block = NONE;
+              }
+            else
+              {
+                symbol -= 257;
+                if (symbol >= 29)
+                  {
+                    Fail ();
+                    break;
+                  }
+                uint32_t len = lbase[symbol] + Bits (lext[symbol]);
+                int dsymbol = Decode (m_distcode);
+                if (dsymbol < 0 || dsymbol >= 30)
+                  {
+                    Fail ();
+                    break;
+                  }
+                uint32_t dist = dbase[dsymbol] + Bits (dext[dsymbol]);
+                if (m_failed || dist > m_size)
+                  {
+                    Fail (); // reference before the beginning of data
+                    break;
+                  }
+                m_copyLen = len;
+                m_copyDist = dist;
+              }
+            break;
+          }
+        }
+    }
+  return produced;
+}
+
+/////////////////////////////////////////////
+// class CompressedFileBuf
+// stream buffer with uncompressed content of a gzip or zip file
+/////////////////////////////////////////////
+class CompressedFileBuf : public std::streambuf
+{
+public:
+  CompressedFileBuf (std::string fileName);
+
+  bool IsOpen () const { return m_open; }; // file exists and its header is valid
+  bool IsFailed () const; // data is corrupted or CRC does not match
+  static bool IsCompressed (std::string fileName); // gzip or zip file
+
+protected:
+  int_type underflow ();
+
+private:
+  bool ReadGzipHeader ();
+  bool ReadZipHeader ();
+  uint32_t ReadLe (uint32_t bytes); // little endian number from the file
+
+  std::ifstream m_file;
+  Inflater m_inflater;
+  bool m_open;
+  bool m_gzip;
+  bool m_checkCrc; // expected CRC is known
+  uint32_t m_crc;
+  bool m_crcFailed;
+  std::vector<char> m_buf;
+};
+
+CompressedFileBuf::CompressedFileBuf (std::string fileName)
+  : m_file (fileName.c_str (), std::ifstream::binary),
+    m_inflater (m_file),
+    m_open (false),
+    m_gzip (false),
+    m_checkCrc (false),
+    m_crc (0),
+    m_crcFailed (false),
+    m_buf (65536)
+{
+  if (!m_file.is_open ())
+    {
+      return;
+    }
+  int b0 = m_file.get ();
+  int b1 = m_file.get ();
+  if (b0 == 0x1f && b1 == 0x8b)
+    {
+      m_gzip = true;
+      m_open = ReadGzipHeader ();
+    }
+  else if (b0 == 'P' && b1 == 'K')
+    {
+      m_open = ReadZipHeader ();
+    }
+  setg (m_buf.data (), m_buf.data (), m_buf.data ());
+}
+
+bool
+CompressedFileBuf::IsCompressed (std::string fileName)
+{
+  std::ifstream file (fileName.c_str (), std::ifstream::binary);
+  int b0 = file.get ();
+  int b1 = file.get ();
+  return (b0 == 0x1f && b1 == 0x8b) || (b0 == 'P' && b1 == 'K');
+}
+
+uint32_t
+CompressedFileBuf::ReadLe (uint32_t bytes)
+{
+  uint32_t v = 0;
+  for (uint32_t i = 0; i < bytes; i++)
+    {
+      v |= (uint32_t) (m_file.get () & 0xff) << (8 * i);
+    }
+  return v;
+}
+
+bool
+CompressedFileBuf::ReadGzipHeader ()
+{
+  // RFC 1952: method, flags, time, extra flags, OS and optional fields
+  uint32_t method = ReadLe (1);
+  uint32_t flags = ReadLe (1);
+  ReadLe (6);
+  if (flags & 4)
+    {
+      m_file.ignore (ReadLe (2)); // FEXTRA
+    }
+  if (flags & 8)
+    {
+      m_file.ignore (std::numeric_limits<std::streamsize>::max (), '\0'); // FNAME
+    }
+  if (flags & 16)
+    {
+      m_file.ignore (std::numeric_limits<std::streamsize>::max (), '\0'); // FCOMMENT
+    }
+  if (flags & 2)
+    {
+      ReadLe (2); // FHCRC
+    }
+  return m_file.good () && method == 8;
+}
+
+bool
+CompressedFileBuf::ReadZipHeader ()
+{
+  // local file header of the first entry
+  if (ReadLe (2) != 0x0403)
+    {
+      return false;
+    }
+  ReadLe (2); // version needed
+  uint32_t flags = ReadLe (2);
+  uint32_t method = ReadLe (2);
+  ReadLe (4); // time and date
+  m_crc = ReadLe (4);
+  uint32_t compressedSize = ReadLe (4);
+  ReadLe (4); // uncompressed size
+  uint32_t nameLen = ReadLe (2);
+  uint32_t extraLen = ReadLe (2);
+  m_file.ignore (nameLen + extraLen);
+  m_checkCrc = (flags & 8) == 0; // otherwise CRC is in data descriptor after the data
+  if (!m_file.good () || (flags & 1) != 0)
+    {
+      return false; // encrypted
+    }
+  if (method == 0 && m_checkCrc)
+    {
+      m_inflater.SetStored (compressedSize);
+      return true;
+    }
+  return method == 8;
+}
+
+CompressedFileBuf::int_type
+CompressedFileBuf::underflow ()
+{
+  if (gptr () < egptr ())
+    {
+      return traits_type::to_int_type (*gptr ());
+    }
+  if (!m_open)
+    {
+      return traits_type::eof ();
+    }
+  size_t n = m_inflater.Read (m_buf.data (), m_buf.size ());
+  if (n == 0)
+    {
+      if (m_inflater.IsFinished () && !m_inflater.IsFailed () && m_gzip)
+        {
+          // gzip trailer: CRC-32 and size of data
+          uint32_t crc = 0;
+          for (int i = 0; i < 4; i++)
+            {
+              crc |= (uint32_t) (m_inflater.ReadByte () & 0xff) << (8 * i);
+            }
+          m_crc = crc;
+          m_checkCrc = true;
+          m_gzip = false; // trailer is read only once
+        }
+      if (m_checkCrc && m_inflater.GetCrc () != m_crc)
+        {
+          m_crcFailed = true;
+        }
+      m_checkCrc = false;
+      return traits_type::eof ();
+    }
+  setg (m_buf.data (), m_buf.data (), m_buf.data () + n);
+  return traits_type::to_int_type (*gptr ());
+}
+
+bool
+CompressedFileBuf::IsFailed () const
+{
+  return !m_open || m_inflater.IsFailed () || m_crcFailed;
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_INFLATE_H */
@@ -0,0 +1,550 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Mobility support for vanet-npaf.cc
+
+  MobilityTrace reads an ns-2 mobility trace (BonnMotion/SUMO output) once and keeps
+  the resulting course changes in memory, so every following replication in the same
+  process installs mobility without parsing the text file again. The course changes
+  are the ones Ns2MobilityHelper would schedule for the same file: the same times and
+  velocities, with positions reached computed the same way (start + speed * time), so
+  trajectories match it bit for bit.
+
+  Course changes can be scheduled lazily: only the next course change of every node
+  is in the event queue, the following one is scheduled when it happens, so the
+  queue holds one event per node instead of the whole trace.
+
+  The parsed trace can be saved in a binary file (initial positions and course changes
+  of all nodes, indexed per node) that is later mapped into memory instead of parsed,
+  so loading takes no time and all processes share one copy in the page cache.
+
+  A node is in the trace from the beginning if its initial position is given, otherwise
+  from its first course change. It leaves the trace at its last course change if it then
+  stays outside the simulation area for good (e.g. a SUMO vehicle that has driven off the
+  map); a node that stops inside the area, e.g. at the end of the trace, stays in it.
+  GetActivity returns these times.
+*/
+
+#ifndef VANET_NPAF_MOBILITY_H
+#define VANET_NPAF_MOBILITY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+
+#include "vanet-npaf-inflate.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// struct TraceEvent
+// one scheduled change of position or velocity of a node
+/////////////////////////////////////////////
+struct TraceEvent
+{
+  enum Kind
+  {
+    SET_POSITION = 0,
+    SET_VELOCITY = 1
+  };
+
+  double time; // [s]
+  uint32_t kind; // SET_POSITION or SET_VELOCITY
+  double x; // position [m] or velocity [m/s]
+  double y;
+  double z;
+};
+
+/////////////////////////////////////////////
+// class MobilityTrace
+// ns-2 mobility trace parsed into per node course changes
+/////////////////////////////////////////////
+class MobilityTrace
+{
+public:
+  MobilityTrace ();
+
+  bool LoadNs2 (std::string fileName); // parse ns-2 trace (plain text, gzip or zip), returns false if file can not be read
+  bool SaveBinary (std::string fileName) const; // binary copy of the parsed trace
+  bool LoadBinary (std::string fileName); // maps binary file into memory, returns false if it is not a valid trace
+  void Install (NodeContainer nodes, bool lazy = true) const; // node i gets movements of $node_(i) from trace, trace must exist until the end of simulation
+
+  uint32_t GetNNodes () const { return m_nodes.size (); };
+  uint64_t GetNEvents () const { return m_nEvents; };
+  // [s] node is in the trace from enter to leave (infinity if it does not leave the area width x height), false if not in the trace at all
+  bool GetActivity (uint32_t id, double width, double height, double &enter, double &leave) const;
+
+private:
+  // initial position and index of course changes of one node, also the layout in binary file
+  struct NodeTrace
+  {
+    NodeTrace () : present (0), initial (0), x0 (0.0), y0 (0.0), z0 (0.0), firstEvent (0), nEvents (0) {};
+    uint32_t present; // node is mentioned in the trace
+    uint32_t initial; // initial position is given
+    double x0; // initial position
+    double y0;
+    double z0;
+    uint64_t firstEvent; // course changes in order of scheduling
+    uint64_t nEvents;
+  };
+
+  // beginning of binary file
+  struct BinaryHeader
+  {
+    char magic[8];
+    uint32_t eventSize; // sizeof (TraceEvent), files of other builds are not used
+    uint32_t nNodes;
+    uint64_t nEvents;
+  };
+
+  // same as Ns2MobilityHelper's DestinationPoint, used only while parsing
+  struct Destination
+  {
+    Destination () : startX (0.0), startY (0.0), speedX (0.0), speedY (0.0),
+                     finalX (0.0), finalY (0.0), finalZ (0.0),
+                     travelStartTime (0.0), targetArrivalTime (0.0), stopEvent (-1) {};
+    double startX;
+    double startY;
+    double speedX;
+    double speedY;
+    double finalX;
+    double finalY;
+    double finalZ;
+    double travelStartTime;
+    double targetArrivalTime;
+    int64_t stopEvent; // index of pending stop event in NodeTrace::events, -1 if none
+  };
+
+  static bool ParseNodeId (const std::string &token, uint32_t &id);
+  static void SetCoordinate (const std::string &coord, double value, double &x, double &y, double &z);
+  const TraceEvent * GetEvents () const { return m_mapped ? m_mappedEvents : m_events.data (); };
+  static void Apply (Ptr<ConstantVelocityMobilityModel> model, const TraceEvent &ev);
+  static void ApplyNext (Ptr<ConstantVelocityMobilityModel> model, const TraceEvent *ev, const TraceEvent *end);
+
+  std::vector<NodeTrace> m_nodes;
+  std::vector<TraceEvent> m_events; // course changes of all nodes, node after node (parsed trace)
+  std::shared_ptr<void> m_mapped; // binary file mapped into memory, shared by copies of this trace
+  const TraceEvent *m_mappedEvents; // course changes in the mapped file
+  uint64_t m_nEvents;
+};
+
+MobilityTrace::MobilityTrace ()
+  : m_mappedEvents (NULL),
+    m_nEvents (0)
+{
+}
+
+bool
+MobilityTrace::ParseNodeId (const std::string &token, uint32_t &id)
+{
+  // token looks like $node_(12)
+  std::string::size_type open = token.find ('(');
+  std::string::size_type close = token.find (')');
+  if (token.compare (0, 6, "$node_") != 0 || open == std::string::npos || close == std::string::npos || close <= open + 1)
+    {
+      return false;
+    }
+  std::string digits = token.substr (open + 1, close - open - 1);
+  if (digits.find_first_not_of ("0123456789") != std::string::npos)
+    {
+      return false;
+    }
+  id = std::strtoul (digits.c_str (), NULL, 10);
+  return true;
+}
+
+void
+MobilityTrace::SetCoordinate (const std::string &coord, double value, double &x, double &y, double &z)
+{
+  if (coord == "X_")
+    x = value;
+  else if (coord == "Y_")
+    y = value;
+  else if (coord == "Z_")
+    z = value;
+}
+
+bool
+MobilityTrace::LoadNs2 (std::string fileName)
+{
+  // compressed trace is decompressed while it is read
+  std::ifstream text;
+  std::unique_ptr<CompressedFileBuf> compressed;
+  if (CompressedFileBuf::IsCompressed (fileName))
+    {
+      compressed.reset (new CompressedFileBuf (fileName));
+    }
+  else
+    {
+      text.open (fileName.c_str ());
+    }
+  std::istream file (compressed ? (std::streambuf *) compressed.get () : text.rdbuf ());
+  if (compressed ? !compressed->IsOpen () : !text.is_open ())
+    {
+      return false;
+    }
+  m_nodes.clear ();
+  m_events.clear ();
+  m_mapped.reset ();
+  m_mappedEvents = NULL;
+
+  std::vector<std::vector<TraceEvent> > events; // course changes of each node
+  std::vector<Destination> lastPos; // previous movement for each node
+  std::vector<std::vector<bool> > cancelled; // stop events canceled by later movements
+  std::string line;
+  std::vector<std::string> tokens;
+  while (std::getline (file, line))
+    {
+      // split line into tokens, quotes are not important
+      for (std::string::iterator c = line.begin (); c != line.end (); ++c)
+        {
+          if (*c == '"')
+            *c = ' ';
+        }
+      tokens.clear ();
+      std::istringstream ss (line);
+      std::string t;
+      while (ss >> t)
+        {
+          tokens.push_back (t);
+        }
+      if (tokens.size () != 4 && tokens.size () != 7 && tokens.size () != 8)
+        {
+          continue; // empty or corrupted line (ignored by Ns2MobilityHelper too)
+        }
+
+      uint32_t id;
+      if (!ParseNodeId (tokens.size () == 4 ? tokens[0] : tokens[3], id))
+        {
+          continue;
+        }
+      if (id >= m_nodes.size ())
+        {
+          m_nodes.resize (id + 1);
+          events.resize (id + 1);
+          lastPos.resize (id + 1);
+          cancelled.resize (id + 1);
+        }
+      NodeTrace &node = m_nodes[id];
+      node.present = 1;
+      Destination &last = lastPos[id];
+
+      if (tokens.size () == 4 && tokens[1] == "set")
+        {
+          // initial position, e.g. $node_(0) set X_ 151.05
+          SetCoordinate (tokens[2], std::strtod (tokens[3].c_str (), NULL), node.x0, node.y0, node.z0);
+          node.initial = 1;
+          last = Destination ();
+          last.finalX = node.x0;
+          last.finalY = node.y0;
+          last.finalZ = node.z0;
+        }
+      else if (tokens.size () == 8 && tokens[0] == "$ns_" && tokens[1] == "at" && tokens[4] == "setdest")
+        {
+          // new waypoint, e.g. $ns_ at 1 "$node_(0) setdest 2 3 4"
+          double at = std::strtod (tokens[2].c_str (), NULL);
+          double xFinal = std::strtod (tokens[5].c_str (), NULL);
+          double yFinal = std::strtod (tokens[6].c_str (), NULL);
+          double speed = std::strtod (tokens[7].c_str (), NULL);
+          if (last.targetArrivalTime > at)
+            {
+              // destination not reached, node continues from where it is at time "at"
+              double traveled = at - last.travelStartTime;
+              last.finalX = last.startX + last.speedX * traveled;
+              last.finalY = last.startY + last.speedY * traveled;
+              last.finalZ = 0;
+              if (last.stopEvent >= 0)
+                {
+                  cancelled[id][last.stopEvent] = true;
+                }
+            }
+
+          Destination next;
+          next.startX = last.finalX;
+          next.startY = last.finalY;
+          next.finalX = last.finalX;
+          next.finalY = last.finalY;
+          next.finalZ = last.finalZ;
+          next.travelStartTime = at;
+          next.targetArrivalTime = at;
+          if (speed == 0)
+            {
+              // stay at the last position
+              TraceEvent stop = { at, TraceEvent::SET_VELOCITY, 0.0, 0.0, 0.0 };
+              next.stopEvent = events[id].size ();
+              events[id].push_back (stop);
+              cancelled[id].push_back (false);
+            }
+          else if (speed > 0)
+            {
+              double time = std::sqrt (std::pow (xFinal - next.finalX, 2) + std::pow (yFinal - next.finalY, 2)) / speed;
+              if (time != 0)
+                {
+                  double xSpeed = (xFinal - next.finalX) / time;
+                  double ySpeed = (yFinal - next.finalY) / time;
+                  next.speedX = xSpeed;
+                  next.speedY = ySpeed;
+                  if (xSpeed != 0 || ySpeed != 0)
+                    {
+                      TraceEvent move = { at, TraceEvent::SET_VELOCITY, xSpeed, ySpeed, 0.0 };
+                      events[id].push_back (move);
+                      cancelled[id].push_back (false);
+                    }
+                  next.targetArrivalTime += time;
+                  // computed like Ns2MobilityHelper, not taken from the trace: start + speed * time
+                  // may differ from (xFinal, yFinal) in the last bits
+                  next.finalX += xSpeed * time;
+                  next.finalY += ySpeed * time;
+                  TraceEvent stop = { at + time, TraceEvent::SET_VELOCITY, 0.0, 0.0, 0.0 };
+                  next.stopEvent = events[id].size ();
+                  events[id].push_back (stop);
+                  cancelled[id].push_back (false);
+                }
+            }
+          last = next;
+        }
+      else if (tokens.size () == 7 && tokens[0] == "$ns_" && tokens[1] == "at" && tokens[4] == "set")
+        {
+          // scheduled position, e.g. $ns_ at 4.63 "$node_(0) set X_ 28.67"
+          // like Ns2MobilityHelper, other coordinates are taken from the initial position
+          double at = std::strtod (tokens[2].c_str (), NULL);
+          TraceEvent pos = { at, TraceEvent::SET_POSITION, node.x0, node.y0, node.z0 };
+          SetCoordinate (tokens[5], std::strtod (tokens[6].c_str (), NULL), pos.x, pos.y, pos.z);
+          events[id].push_back (pos);
+          cancelled[id].push_back (false);
+          last.finalX = pos.x;
+          last.finalY = pos.y;
+          last.finalZ = pos.z;
+          if (last.targetArrivalTime > at && last.stopEvent >= 0)
+            {
+              cancelled[id][last.stopEvent] = true;
+            }
+          last.targetArrivalTime = at;
+          last.travelStartTime = at;
+        }
+    }
+
+  // drop canceled stop events, events of all nodes are kept in one array
+  for (uint32_t id = 0; id < m_nodes.size (); id++)
+    {
+      m_nodes[id].firstEvent = m_events.size ();
+      for (uint64_t i = 0; i < events[id].size (); i++)
+        {
+          if (!cancelled[id][i])
+            {
+              m_events.push_back (events[id][i]);
+            }
+        }
+      m_nodes[id].nEvents = m_events.size () - m_nodes[id].firstEvent;
+      // order of execution: by time, events at the same time in order of scheduling
+      std::stable_sort (m_events.begin () + m_nodes[id].firstEvent, m_events.end (),
+                        [] (const TraceEvent &a, const TraceEvent &b) { return a.time < b.time; });
+    }
+  m_nEvents = m_events.size ();
+  return !compressed || !compressed->IsFailed ();
+}
+
+bool
+MobilityTrace::SaveBinary (std::string fileName) const
+{
+  // written under a temporary name and renamed, so that other processes never map half a file
+  std::string tmpName = fileName + ".tmp" + std::to_string (getpid ());
+  std::ofstream file (tmpName.c_str (), std::ofstream::binary | std::ofstream::trunc);
+  BinaryHeader header;
+  std::memcpy (header.magic, "NS2TRCB3", 8);
+  header.eventSize = sizeof (TraceEvent);
+  header.nNodes = m_nodes.size ();
+  header.nEvents = m_nEvents;
+  file.write ((const char *) &header, sizeof (header));
+  file.write ((const char *) m_nodes.data (), m_nodes.size () * sizeof (NodeTrace));
+  file.write ((const char *) GetEvents (), m_nEvents * sizeof (TraceEvent));
+  file.close ();
+  if (!file || std::rename (tmpName.c_str (), fileName.c_str ()) != 0)
+    {
+      std::remove (tmpName.c_str ());
+      return false;
+    }
+  return true;
+}
+
+bool
+MobilityTrace::LoadBinary (std::string fileName)
+{
+  int fd = open (fileName.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      return false;
+    }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || (size_t) st.st_size < sizeof (BinaryHeader))
+    {
+      close (fd);
+      return false;
+    }
+  size_t size = st.st_size;
+  void *map = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd); // mapping stays valid
+  if (map == MAP_FAILED)
+    {
+      return false;
+    }
+  std::shared_ptr<void> mapped (map, [size] (void *p) { munmap (p, size); });
+
+  const BinaryHeader *header = (const BinaryHeader *) map;
+  if (std::memcmp (header->magic, "NS2TRCB3", 8) != 0 || header->eventSize != sizeof (TraceEvent)
+      || size != sizeof (BinaryHeader) + header->nNodes * sizeof (NodeTrace) + header->nEvents * sizeof (TraceEvent))
+    {
+      return false;
+    }
+  // node index is small and copied, course changes stay in the mapped file
+  const NodeTrace *nodes = (const NodeTrace *) (header + 1);
+  m_nodes.assign (nodes, nodes + header->nNodes);
+  m_events.clear ();
+  m_nEvents = header->nEvents;
+  m_mappedEvents = (const TraceEvent *) (nodes + header->nNodes);
+  m_mapped = mapped;
+  return true;
+}
+
+bool
+MobilityTrace::GetActivity (uint32_t id, double width, double height, double &enter, double &leave) const
+{
+  if (id >= m_nodes.size () || m_nodes[id].present == 0)
+    {
+      return false;
+    }
+  const NodeTrace &trace = m_nodes[id];
+  const TraceEvent *events = GetEvents () + trace.firstEvent;
+  enter = trace.initial != 0 || trace.nEvents == 0 ? 0.0 : events[0].time;
+  leave = std::numeric_limits<double>::infinity ();
+
+  // position after the last course change, as ConstantVelocityMobilityModel moves the node
+  double x = trace.x0;
+  double y = trace.y0;
+  double speedX = 0.0;
+  double speedY = 0.0;
+  double last = 0.0;
+  for (uint64_t i = 0; i < trace.nEvents; i++)
+    {
+      const TraceEvent &ev = events[i];
+      x += speedX * (ev.time - last);
+      y += speedY * (ev.time - last);
+      last = ev.time;
+      if (ev.kind == TraceEvent::SET_VELOCITY)
+        {
+          speedX = ev.x;
+          speedY = ev.y;
+        }
+      else
+        {
+          x = ev.x;
+          y = ev.y;
+        }
+    }
+  // a node that keeps moving or stops inside the area has not left it
+  if (trace.nEvents != 0 && speedX == 0.0 && speedY == 0.0 && (x < 0.0 || x > width || y < 0.0 || y > height))
+    {
+      leave = last;
+    }
+  return true;
+}
+
+void
+MobilityTrace::Apply (Ptr<ConstantVelocityMobilityModel> model, const TraceEvent &ev)
+{
+  if (ev.kind == TraceEvent::SET_VELOCITY)
+    {
+      model->SetVelocity (Vector (ev.x, ev.y, ev.z));
+    }
+  else
+    {
+      model->SetPosition (Vector (ev.x, ev.y, ev.z));
+    }
+}
+
+void
+MobilityTrace::ApplyNext (Ptr<ConstantVelocityMobilityModel> model, const TraceEvent *ev, const TraceEvent *end)
+{
+  // all course changes at this time, in the same order as if they were scheduled up front
+  double now = ev->time;
+  for (; ev != end && ev->time == now; ++ev)
+    {
+      Apply (model, *ev);
+    }
+  if (ev != end)
+    {
+      Simulator::Schedule (Seconds (ev->time) - Simulator::Now (), &MobilityTrace::ApplyNext, model, ev, end);
+    }
+}
+
+void
+MobilityTrace::Install (NodeContainer nodes, bool lazy) const
+{
+  for (uint32_t id = 0; id < m_nodes.size () && id < nodes.GetN (); id++)
+    {
+      const NodeTrace &trace = m_nodes[id];
+      if (trace.present == 0)
+        {
+          continue;
+        }
+      Ptr<Node> node = nodes.Get (id);
+      Ptr<ConstantVelocityMobilityModel> model = node->GetObject<ConstantVelocityMobilityModel> ();
+      if (model == 0)
+        {
+          model = CreateObject<ConstantVelocityMobilityModel> ();
+          node->AggregateObject (model);
+        }
+      model->SetPosition (Vector (trace.x0, trace.y0, trace.z0));
+
+      const TraceEvent *events = GetEvents () + trace.firstEvent;
+      if (lazy)
+        {
+          if (trace.nEvents > 0)
+            {
+              Simulator::Schedule (Seconds (events->time), &MobilityTrace::ApplyNext, model, events, events + trace.nEvents);
+            }
+          continue;
+        }
+      for (const TraceEvent *ev = events; ev != events + trace.nEvents; ++ev)
+        {
+          Simulator::Schedule (Seconds (ev->time), &MobilityTrace::Apply, model, *ev);
+        }
+    }
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_MOBILITY_H */
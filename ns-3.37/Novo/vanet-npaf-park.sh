@@ -0,0 +1,33 @@
+#!/bin/bash
+
+# Executed events and wall clock time of one run of the semafor trace scenario with
+# vehicles parked while they are not in the trace and with all vehicles active all the time.
+# Parking saves only channel work (see SetVehicleActive), so the difference in events is
+# the receive events of parked vehicles; their routing and application timers still run.
+
+# Name of the script (.cc file in the scratch folder)
+PROGRAM_NAME="vanet-npaf"
+
+RESULT="vanet-npaf-park.csv"
+
+# Fixed seed, no cache (runs are always simulated); columns of $RESULT as of --benchmarkFile
+OPTIONS="--scenario=2 --nNodes=350 --nSources=10 --simTime=100 --startupTime=50 --startRngRun=1 --stopRngRun=1 --workers=1 --cacheDir= --benchmarkFile=$RESULT"
+
+rm -f $RESULT
+for PARK in 0 1
+do
+  echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+  echo x   "./ns3 run \"$PROGRAM_NAME $OPTIONS --parkInactive=$PARK --csvFileNamePrefix=Park$PARK\""
+  echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+  ./ns3 run "$PROGRAM_NAME $OPTIONS --parkInactive=$PARK --csvFileNamePrefix=Park$PARK" > /dev/null || exit 2
+done
+
+# rows in the order of the runs: parking off, parking on
+awk -F, '
+  FNR == 1 { next }
+  { park = NR - 2; events[park] = $11; wall[park] = $7 }
+  END {
+    printf "parkInactive=0: %12d events, %8.2f s\n", events[0], wall[0]
+    printf "parkInactive=1: %12d events, %8.2f s (%.2fx events, %.2fx time)\n", events[1], wall[1],
+           events[1] / events[0], wall[1] / wall[0]
+  }' $RESULT
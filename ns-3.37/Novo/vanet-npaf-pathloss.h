@@ -0,0 +1,235 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Batch path loss for vanet-npaf.cc
+
+  BatchPathLoss computes the received power of one transmission at many receivers in
+  one pass over arrays of receiver coordinates, instead of a virtual call per receiver.
+  It replaces the first model of a loss chain, if that model is Friis or TwoRayGround;
+  its constants (wavelength, system loss, antenna height) are read from the model's
+  attributes and the same formulas are used, so results are the same to the last bit.
+  The rest of the chain (e.g. Nakagami fading) is applied per receiver as before.
+
+  Optionally the loss is taken from a table indexed by distance (linear interpolation
+  between points "step" metres apart), which avoids the logarithm. The table is made for
+  nodes on the ground (z = 0), other nodes and distances beyond the table are computed.
+  Results with the table differ slightly from the model.
+*/
+
+#ifndef VANET_NPAF_PATHLOSS_H
+#define VANET_NPAF_PATHLOSS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class BatchPathLoss
+// received power at many receivers of one transmission
+/////////////////////////////////////////////
+class BatchPathLoss
+{
+public:
+  BatchPathLoss ();
+
+  bool Configure (Ptr<PropagationLossModel> loss); // false if the first model of the chain is not supported
+  void SetTable (double step, double range); // [m] loss from table up to range, step 0 = no table
+  bool IsSupported () const { return m_model != NONE; };
+  Ptr<PropagationLossModel> GetNext () const { return m_next; }; // rest of the chain, applied per receiver
+  const double *GetDistance () const { return m_distance.data (); }; // [m] receivers of the last CalcRxPower
+
+  // rxPowerDbm[i] for receivers at (x[i], y[i], z[i]), only the first model of the chain
+  void CalcRxPower (double txPowerDbm, const Vector &from, uint32_t n,
+                    const double *x, const double *y, const double *z, double *rxPowerDbm) const;
+
+private:
+  enum Model { NONE, FRIIS, TWO_RAY };
+
+  double GetGainDb (double distance, double txZ, double rxZ) const; // the same formulas as ns-3 models
+
+  Model m_model;
+  Ptr<PropagationLossModel> m_next;
+  double m_lambda; // [m]
+  double m_systemLoss;
+  double m_minLoss; // [dB] Friis
+  double m_minDistance; // [m] TwoRayGround
+  double m_heightAboveZ; // [m] TwoRayGround
+
+  double m_step; // [m] between points of the table, 0 = no table
+  std::vector<double> m_table; // gain [dB] at i * m_step, nodes at z = 0
+  double m_tableStart; // [m] table is not used below (loss jumps at MinDistance of TwoRayGround)
+  mutable std::vector<double> m_distance; // of the current batch
+};
+
+BatchPathLoss::BatchPathLoss ()
+  : m_model (NONE),
+    m_lambda (0.0),
+    m_systemLoss (1.0),
+    m_minLoss (0.0),
+    m_minDistance (0.0),
+    m_heightAboveZ (0.0),
+    m_step (0.0),
+    m_tableStart (0.0)
+{
+}
+
+bool
+BatchPathLoss::Configure (Ptr<PropagationLossModel> loss)
+{
+  m_model = NONE;
+  m_table.clear ();
+  if (loss == 0)
+    {
+      return false;
+    }
+  std::string name = loss->GetInstanceTypeId ().GetName ();
+  DoubleValue v;
+  if (name == "ns3::FriisPropagationLossModel")
+    {
+      m_model = FRIIS;
+      loss->GetAttribute ("MinLoss", v);
+      m_minLoss = v.Get ();
+    }
+  else if (name == "ns3::TwoRayGroundPropagationLossModel")
+    {
+      m_model = TWO_RAY;
+      loss->GetAttribute ("MinDistance", v);
+      m_minDistance = v.Get ();
+      loss->GetAttribute ("HeightAboveZ", v);
+      m_heightAboveZ = v.Get ();
+    }
+  else
+    {
+      return false;
+    }
+  loss->GetAttribute ("Frequency", v);
+  static const double C = 299792458.0; // speed of light in vacuum, as in ns-3 models
+  m_lambda = C / v.Get ();
+  loss->GetAttribute ("SystemLoss", v);
+  m_systemLoss = v.Get ();
+  m_next = loss->GetNext ();
+  return true;
+}
+
+void
+BatchPathLoss::SetTable (double step, double range)
+{
+  m_step = step;
+  m_table.clear ();
+  if (m_step <= 0.0 || !IsSupported ())
+    {
+      m_step = 0.0;
+      return;
+    }
+  uint32_t n = std::ceil (range / m_step) + 2;
+  m_table.resize (n);
+  m_tableStart = (std::floor (m_minDistance / m_step) + 1) * m_step;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      m_table[i] = GetGainDb (i * m_step, 0.0, 0.0);
+    }
+}
+
+double
+BatchPathLoss::GetGainDb (double distance, double txZ, double rxZ) const
+{
+  if (m_model == FRIIS)
+    {
+      if (distance <= 0)
+        {
+          return -m_minLoss;
+        }
+      double numerator = m_lambda * m_lambda;
+      double denominator = 16 * M_PI * M_PI * distance * distance * m_systemLoss;
+      double lossDb = -10 * std::log10 (numerator / denominator);
+      return -std::max (lossDb, m_minLoss);
+    }
+
+  // TwoRayGround: Friis up to crossover distance
+  if (distance <= m_minDistance)
+    {
+      return 0.0;
+    }
+  double txAntHeight = txZ + m_heightAboveZ;
+  double rxAntHeight = rxZ + m_heightAboveZ;
+  double dCross = (4 * M_PI * txAntHeight * rxAntHeight) / m_lambda;
+  double tmp = 0;
+  if (distance <= dCross)
+    {
+      double numerator = m_lambda * m_lambda;
+      tmp = M_PI * distance;
+      double denominator = 16 * tmp * tmp * m_systemLoss;
+      return 10 * std::log10 (numerator / denominator);
+    }
+  tmp = txAntHeight * rxAntHeight;
+  double rayNumerator = tmp * tmp;
+  tmp = distance * distance;
+  double rayDenominator = tmp * tmp * m_systemLoss;
+  return 10 * std::log10 (rayNumerator / rayDenominator);
+}
+
+void
+BatchPathLoss::CalcRxPower (double txPowerDbm, const Vector &from, uint32_t n,
+                            const double *x, const double *y, const double *z, double *rxPowerDbm) const
+{
+  // distances in a loop without calls, the compiler vectorizes it
+  m_distance.resize (n);
+  double *d = m_distance.data ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      double dx = x[i] - from.x;
+      double dy = y[i] - from.y;
+      double dz = z[i] - from.z;
+      d[i] = std::sqrt (dx * dx + dy * dy + dz * dz);
+    }
+
+  if (m_step > 0.0 && from.z == 0.0)
+    {
+      double last = (m_table.size () - 1) * m_step;
+      for (uint32_t i = 0; i < n; i++)
+        {
+          if (z[i] == 0.0 && d[i] >= m_tableStart && d[i] < last)
+            {
+              double index = d[i] / m_step;
+              uint32_t k = index;
+              double f = index - k;
+              rxPowerDbm[i] = txPowerDbm + m_table[k] + f * (m_table[k + 1] - m_table[k]);
+            }
+          else
+            {
+              rxPowerDbm[i] = txPowerDbm + GetGainDb (d[i], from.z, z[i]);
+            }
+        }
+      return;
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      rxPowerDbm[i] = txPowerDbm + GetGainDb (d[i], from.z, z[i]);
+    }
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_PATHLOSS_H */
@@ -0,0 +1,154 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Position cache for vanet-npaf.cc
+
+  Vehicles of all our scenarios move in straight segments at constant velocity between
+  course changes (ns-2 traces, Manhattan grid, random waypoint). PositionCache keeps the
+  current segment of every node (start, velocity, start time) in arrays, updated at every
+  course change, and computes positions of all nodes in one loop, once per timestamp,
+  instead of a virtual call to the mobility model for every receiver of every transmission.
+
+  Positions are computed from the start of the segment, while mobility models add the
+  movement since the previous query, so they may differ in the last bits.
+*/
+
+#ifndef VANET_NPAF_POSITION_H
+#define VANET_NPAF_POSITION_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class PositionCache
+// positions of all nodes at the current time, structure of arrays
+/////////////////////////////////////////////
+class PositionCache
+{
+public:
+  PositionCache ();
+
+  static bool IsSupported (Ptr<MobilityModel> mobility); // moves at constant velocity between course changes
+  void Clear ();
+  uint32_t Add (Ptr<MobilityModel> mobility); // returns index of the node
+  void Update (uint32_t i); // course change of node i
+  void Refresh (); // positions at the current time
+
+  const double *GetX () const { return m_x.data (); };
+  const double *GetY () const { return m_y.data (); };
+  const double *GetZ () const { return m_z.data (); };
+  Vector GetPosition (uint32_t i) const { return Vector (m_x[i], m_y[i], m_z[i]); }; // after Refresh
+
+private:
+  std::vector<Ptr<MobilityModel> > m_models;
+  // current segments
+  std::vector<double> m_x0; // [m]
+  std::vector<double> m_y0;
+  std::vector<double> m_z0;
+  std::vector<double> m_vx; // [m/s]
+  std::vector<double> m_vy;
+  std::vector<double> m_vz;
+  std::vector<double> m_t0; // [s]
+  // positions at m_time
+  std::vector<double> m_x; // [m]
+  std::vector<double> m_y;
+  std::vector<double> m_z;
+  int64_t m_time; // time step of the positions, -1 = none
+};
+
+PositionCache::PositionCache ()
+  : m_time (-1)
+{
+}
+
+bool
+PositionCache::IsSupported (Ptr<MobilityModel> mobility)
+{
+  static const std::set<std::string> supported = {
+    "ns3::ConstantPositionMobilityModel", "ns3::ConstantVelocityMobilityModel",
+    "ns3::RandomWaypointMobilityModel", "ns3::ManhattanGridMobilityModel" };
+  return supported.count (mobility->GetInstanceTypeId ().GetName ()) != 0;
+}
+
+void
+PositionCache::Clear ()
+{
+  m_models.clear ();
+  for (std::vector<double> *v : {&m_x0, &m_y0, &m_z0, &m_vx, &m_vy, &m_vz, &m_t0, &m_x, &m_y, &m_z})
+    {
+      v->clear ();
+    }
+  m_time = -1;
+}
+
+uint32_t
+PositionCache::Add (Ptr<MobilityModel> mobility)
+{
+  m_models.push_back (mobility);
+  for (std::vector<double> *v : {&m_x0, &m_y0, &m_z0, &m_vx, &m_vy, &m_vz, &m_t0, &m_x, &m_y, &m_z})
+    {
+      v->push_back (0.0);
+    }
+  Update (m_models.size () - 1);
+  return m_models.size () - 1;
+}
+
+void
+PositionCache::Update (uint32_t i)
+{
+  Vector pos = m_models[i]->GetPosition ();
+  Vector velocity = m_models[i]->GetVelocity ();
+  m_x0[i] = m_x[i] = pos.x;
+  m_y0[i] = m_y[i] = pos.y;
+  m_z0[i] = m_z[i] = pos.z;
+  m_vx[i] = velocity.x;
+  m_vy[i] = velocity.y;
+  m_vz[i] = velocity.z;
+  m_t0[i] = Simulator::Now ().GetSeconds ();
+}
+
+void
+PositionCache::Refresh ()
+{
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  if (now == m_time)
+    {
+      return;
+    }
+  m_time = now;
+  double t = Simulator::Now ().GetSeconds ();
+  uint32_t n = m_models.size ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      double dt = t - m_t0[i];
+      m_x[i] = m_x0[i] + m_vx[i] * dt;
+      m_y[i] = m_y0[i] + m_vy[i] * dt;
+      m_z[i] = m_z0[i] + m_vz[i] * dt;
+    }
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_POSITION_H */
@@ -0,0 +1,213 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Event profile for vanet-npaf.cc
+
+  The simulator takes the next event from the scheduler just before it executes it, so
+  the wall clock time between two such calls is the time of the first event (including
+  everything it schedules). EventProfile is told about every event taken from the
+  scheduler (by ObservedScheduler) and adds that time to the type of the event: the
+  class made by MakeEvent, whose name contains the called function's class and
+  arguments. This costs one clock reading and one hash table lookup per event.
+
+  Types are grouped into subsystems (wifi PHY, wifi MAC, routing, mobility...) by the
+  class of the called function. Both tables, ranked by time, are written to a CSV file.
+*/
+
+#ifndef VANET_NPAF_PROFILE_H
+#define VANET_NPAF_PROFILE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cxxabi.h>
+
+#include "ns3/core-module.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class EventProfile
+// count and wall clock time of executed events by type
+/////////////////////////////////////////////
+class EventProfile
+{
+public:
+  EventProfile ();
+
+  void Next (const EventImpl *event); // event is about to be executed, the previous one has ended
+  void Stop (); // the last event has ended
+  bool Write (std::string fileName) const; // ranked tables of subsystems and event types
+
+  static std::string GetTypeName (const std::type_info *type); // demangled
+  static std::string GetSubsystem (const std::string &typeName);
+
+private:
+  struct Entry
+  {
+    uint64_t count;
+    std::chrono::steady_clock::duration time;
+  };
+
+  std::unordered_map<const std::type_info *, Entry> m_entries;
+  const std::type_info *m_current; // type of the event being executed, 0 if none
+  std::chrono::steady_clock::time_point m_since; // start of the current event
+};
+
+EventProfile::EventProfile ()
+  : m_current (0)
+{
+}
+
+void
+EventProfile::Next (const EventImpl *event)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now ();
+  Stop ();
+  m_current = &typeid (*event);
+  m_since = now;
+}
+
+void
+EventProfile::Stop ()
+{
+  if (m_current != 0)
+    {
+      Entry &e = m_entries.insert (std::make_pair (m_current, Entry {0, std::chrono::steady_clock::duration::zero ()})).first->second;
+      e.count++;
+      e.time += std::chrono::steady_clock::now () - m_since;
+      m_current = 0;
+    }
+}
+
+std::string
+EventProfile::GetTypeName (const std::type_info *type)
+{
+  int status;
+  char *name = abi::__cxa_demangle (type->name (), 0, 0, &status);
+  std::string typeName = status == 0 ? name : type->name ();
+  std::free (name);
+  return typeName;
+}
+
+std::string
+EventProfile::GetSubsystem (const std::string &typeName)
+{
+  // class of a member function, e.g. "void (ns3::YansWifiPhy::*)(...)", otherwise the whole name (function arguments)
+  std::string owner = typeName;
+  std::string::size_type member = typeName.find ("::*)");
+  if (member != std::string::npos)
+    {
+      std::string::size_type open = typeName.rfind ('(', member);
+      owner = typeName.substr (open + 1, member - open - 1);
+    }
+  // the first matching rule wins
+  static const std::vector<std::pair<std::string, std::string> > rules = {
+    {"aodv::", "routing"}, {"olsr::", "routing"}, {"dsdv::", "routing"}, {"dsr::", "routing"},
+    {"npaf::", "npaf"},
+    {"ProgressReporter", "vanet-npaf"}, {"WarmupDetector", "vanet-npaf"},
+    {"Mobility", "mobility"}, {"TraceEvent", "mobility"},
+    {"Phy", "wifi PHY"}, {"WifiPpdu", "wifi PHY"}, {"WifiChannel", "wifi PHY"}, {"Interference", "wifi PHY"},
+    {"Mac", "wifi MAC"}, {"Txop", "wifi MAC"}, {"ChannelAccessManager", "wifi MAC"}, {"FrameExchange", "wifi MAC"},
+    {"WifiRemoteStation", "wifi MAC"}, {"WifiNetDevice", "wifi MAC"},
+    {"Ipv4", "internet"}, {"Udp", "internet"}, {"Arp", "internet"}, {"Icmp", "internet"}, {"Socket", "internet"},
+    {"Application", "applications"},
+    {"Timer", "timers"},
+    {"Simulator", "simulator"}};
+  for (std::vector<std::pair<std::string, std::string> >::const_iterator r = rules.begin (); r != rules.end (); ++r)
+    {
+      if (owner.find (r->first) != std::string::npos)
+        {
+          return r->second;
+        }
+    }
+  return "other";
+}
+
+bool
+EventProfile::Write (std::string fileName) const
+{
+  struct Row
+  {
+    std::string subsystem;
+    std::string type;
+    uint64_t count;
+    double seconds;
+  };
+  std::vector<Row> types;
+  std::map<std::string, Row> subsystems;
+  double total = 0.0;
+  for (std::unordered_map<const std::type_info *, Entry>::const_iterator e = m_entries.begin (); e != m_entries.end (); ++e)
+    {
+      Row row;
+      row.type = GetTypeName (e->first);
+      row.subsystem = GetSubsystem (row.type);
+      row.count = e->second.count;
+      row.seconds = std::chrono::duration<double> (e->second.time).count ();
+      types.push_back (row);
+      Row &s = subsystems.insert (std::make_pair (row.subsystem, Row {row.subsystem, "", 0, 0.0})).first->second;
+      s.count += row.count;
+      s.seconds += row.seconds;
+      total += row.seconds;
+    }
+  std::vector<Row> groups;
+  for (std::map<std::string, Row>::const_iterator s = subsystems.begin (); s != subsystems.end (); ++s)
+    {
+      groups.push_back (s->second);
+    }
+  auto slower = [] (const Row &a, const Row &b) { return a.seconds > b.seconds; };
+  std::sort (types.begin (), types.end (), slower);
+  std::sort (groups.begin (), groups.end (), slower);
+
+  std::ofstream file (fileName.c_str (), std::ofstream::trunc);
+  file << "Rank,Subsystem,Events,Wall time [s],Share [%],Mean [us]\n";
+  for (uint32_t i = 0; i < groups.size (); i++)
+    {
+      const Row &r = groups[i];
+      file << i + 1 << "," << r.subsystem << "," << r.count << "," << r.seconds << "," << (total > 0 ? 100 * r.seconds / total : 0.0)
+           << "," << 1e6 * r.seconds / r.count << "\n";
+    }
+  file << "\nRank,Subsystem,Events,Wall time [s],Share [%],Mean [us],Event type\n";
+  for (uint32_t i = 0; i < types.size (); i++)
+    {
+      const Row &r = types[i];
+      // type names contain commas, quotes are doubled
+      std::string quoted;
+      for (std::string::const_iterator c = r.type.begin (); c != r.type.end (); ++c)
+        {
+          quoted += *c == '"' ? std::string ("\"\"") : std::string (1, *c);
+        }
+      file << i + 1 << "," << r.subsystem << "," << r.count << "," << r.seconds << "," << (total > 0 ? 100 * r.seconds / total : 0.0)
+           << "," << 1e6 * r.seconds / r.count << ",\"" << quoted << "\"\n";
+    }
+  file.close ();
+  return !file.fail ();
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_PROFILE_H */
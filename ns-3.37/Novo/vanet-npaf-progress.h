@@ -0,0 +1,400 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Live progress of runs for vanet-npaf.cc
+
+  Every process that simulates runs keeps a ProgressRecord in a file <pid>.progress of
+  the progress directory, mapped into memory, and ProgressReporter updates it every
+  simulated second: simulated time, simulated seconds per wall clock second, events per
+  second, events in the queue, peak memory and estimated wall clock time to the end of
+  the current run. The directory is in /dev/shm by default, so records never go to disk.
+
+  ProgressMonitor (vanet-npaf --monitor=1) shows the records of all running processes,
+  e.g. all workers of all sweeps on a machine. Records are written under a sequence
+  number (odd while the record is written), so the monitor never shows half an update;
+  records of processes that no longer exist are removed by the monitor. A record is made
+  as <pid>.progress.tmp and renamed when it is complete, so the monitor never maps an
+  empty file or a record without its pid.
+*/
+
+#ifndef VANET_NPAF_PROGRESS_H
+#define VANET_NPAF_PROGRESS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ns3/core-module.h"
+#include "vanet-npaf-scheduler.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// struct ProgressRecord
+// state of the current run of one process, layout of the .progress file
+/////////////////////////////////////////////
+struct ProgressRecord
+{
+  enum State
+  {
+    IDLE = 0, // between runs
+    RUNNING = 1
+  };
+
+  uint64_t sequence; // odd while the record is written
+  uint32_t pid;
+  uint32_t state;
+  uint64_t rngRun;
+  uint64_t events; // executed in this run
+  uint64_t queueSize; // events in the queue
+  double simTime; // [s]
+  double stopTime; // [s] end of the run
+  double wallTime; // [s] since the start of the run
+  double ratio; // simulated seconds per wall clock second, in the last update
+  double eventsPerSecond; // per wall clock second, in the last update
+  double peakRssMb; // of the process
+  double eta; // [s] wall clock time to the end of the run
+  char name[128]; // summary file name of the experiment
+};
+
+/////////////////////////////////////////////
+// class ProgressReporter
+// keeps the progress record of this process up to date
+/////////////////////////////////////////////
+class ProgressReporter
+{
+public:
+  ProgressReporter ();
+  ~ProgressReporter (); // record is removed
+
+  bool Open (std::string dir); // record of this process, false if it can not be made
+  void Start (uint64_t rngRun, std::string name, double stopTime); // beginning of a run, updates are scheduled
+  void SetStopTime (double stopTime) { m_stopTime = stopTime; }; // [s] e.g. when warm-up ends
+  void Finish (); // end of the run
+
+private:
+  void Update ();
+  void Write (uint32_t state);
+  static double GetWallTime (); // [s]
+
+  ProgressRecord *m_record;
+  std::string m_fileName;
+  pid_t m_pid; // process that mapped the record (workers are forked)
+  uint64_t m_rngRun;
+  std::string m_name;
+  double m_stopTime;
+  double m_startWall; // [s]
+  double m_lastWall; // [s] of the last update
+  double m_lastSim;
+  uint64_t m_startEvents; // event count of the simulator at the start of the run
+  uint64_t m_lastEvents;
+};
+
+ProgressReporter::ProgressReporter ()
+  : m_record (NULL),
+    m_pid (0),
+    m_rngRun (0),
+    m_stopTime (0.0),
+    m_startWall (0.0),
+    m_lastWall (0.0),
+    m_lastSim (0.0),
+    m_startEvents (0),
+    m_lastEvents (0)
+{
+}
+
+ProgressReporter::~ProgressReporter ()
+{
+  if (m_record != NULL && m_pid == getpid ())
+    {
+      munmap (m_record, sizeof (ProgressRecord));
+      unlink (m_fileName.c_str ());
+    }
+}
+
+double
+ProgressReporter::GetWallTime ()
+{
+  return std::chrono::duration<double> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+bool
+ProgressReporter::Open (std::string dir)
+{
+  if (m_record != NULL && m_pid == getpid ())
+    {
+      return true;
+    }
+  // a forked worker makes its own record; the parent's mapping is left to the parent
+  m_record = NULL;
+  m_pid = getpid ();
+  mkdir (dir.c_str (), 0777);
+  m_fileName = dir + "/" + std::to_string (m_pid) + ".progress";
+  std::string tmpName = m_fileName + ".tmp";
+  int fd = open (tmpName.c_str (), O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      return false;
+    }
+  void *map = MAP_FAILED;
+  if (ftruncate (fd, sizeof (ProgressRecord)) == 0)
+    {
+      map = mmap (NULL, sizeof (ProgressRecord), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+  close (fd); // mapping stays valid
+  if (map == MAP_FAILED)
+    {
+      unlink (tmpName.c_str ());
+      return false;
+    }
+  ProgressRecord *record = (ProgressRecord *) map;
+  std::memset (record, 0, sizeof (ProgressRecord));
+  record->pid = m_pid;
+  // the monitor sees the record only when it is complete
+  if (rename (tmpName.c_str (), m_fileName.c_str ()) != 0)
+    {
+      munmap (map, sizeof (ProgressRecord));
+      unlink (tmpName.c_str ());
+      return false;
+    }
+  m_record = record;
+  return true;
+}
+
+void
+ProgressReporter::Write (uint32_t state)
+{
+  double wall = GetWallTime ();
+  double sim = Simulator::Now ().GetSeconds ();
+  uint64_t events = Simulator::GetEventCount ();
+  double interval = wall - m_lastWall;
+  ProgressRecord &r = *m_record;
+  __atomic_store_n (&r.sequence, r.sequence + 1, __ATOMIC_RELAXED);
+  std::atomic_thread_fence (std::memory_order_release);
+  r.state = state;
+  r.rngRun = m_rngRun;
+  r.events = events - m_startEvents;
+  r.queueSize = ObservedScheduler::GetSize ();
+  r.simTime = sim;
+  r.stopTime = m_stopTime;
+  r.wallTime = wall - m_startWall;
+  r.ratio = interval > 0 ? (sim - m_lastSim) / interval : 0.0;
+  r.eventsPerSecond = interval > 0 ? (events - m_lastEvents) / interval : 0.0;
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  r.peakRssMb = usage.ru_maxrss / 1024.0; // kB on Linux
+  // from the average speed of the run so far
+  r.eta = sim > 0 ? (m_stopTime - sim) * (wall - m_startWall) / sim : 0.0;
+  std::strncpy (r.name, m_name.c_str (), sizeof (r.name) - 1);
+  std::atomic_thread_fence (std::memory_order_release);
+  __atomic_store_n (&r.sequence, r.sequence + 1, __ATOMIC_RELEASE);
+  m_lastWall = wall;
+  m_lastSim = sim;
+  m_lastEvents = events;
+}
+
+void
+ProgressReporter::Start (uint64_t rngRun, std::string name, double stopTime)
+{
+  if (m_record == NULL || m_pid != getpid ())
+    {
+      return;
+    }
+  m_rngRun = rngRun;
+  m_name = name;
+  m_stopTime = stopTime;
+  m_startWall = m_lastWall = GetWallTime ();
+  m_lastSim = 0.0;
+  m_startEvents = m_lastEvents = Simulator::GetEventCount ();
+  std::memset (m_record->name, 0, sizeof (m_record->name));
+  Write (ProgressRecord::RUNNING);
+  Simulator::Schedule (Seconds (1), &ProgressReporter::Update, this);
+}
+
+void
+ProgressReporter::Update ()
+{
+  Write (ProgressRecord::RUNNING);
+  Simulator::Schedule (Seconds (1), &ProgressReporter::Update, this);
+}
+
+void
+ProgressReporter::Finish ()
+{
+  if (m_record != NULL && m_pid == getpid ())
+    {
+      Write (ProgressRecord::IDLE);
+    }
+}
+
+/////////////////////////////////////////////
+// class ProgressMonitor
+// shows progress records of all processes
+/////////////////////////////////////////////
+class ProgressMonitor
+{
+public:
+  static int Run (std::string dir, double interval = 2.0); // until no process has a record
+  static std::vector<ProgressRecord> Read (std::string dir); // records of running processes
+
+private:
+  static void Print (const std::vector<ProgressRecord> &records);
+  static std::string FormatTime (double seconds); // h:mm:ss
+};
+
+std::vector<ProgressRecord>
+ProgressMonitor::Read (std::string dir)
+{
+  std::vector<ProgressRecord> records;
+  DIR *d = opendir (dir.c_str ());
+  if (d == NULL)
+    {
+      return records;
+    }
+  struct dirent *entry;
+  while ((entry = readdir (d)) != NULL)
+    {
+      std::string file = entry->d_name;
+      // records being made (.progress.tmp) are skipped
+      if (file.size () <= 9 || file.compare (file.size () - 9, 9, ".progress") != 0)
+        {
+          continue;
+        }
+      std::string path = dir + "/" + file;
+      int fd = open (path.c_str (), O_RDONLY);
+      if (fd < 0)
+        {
+          continue;
+        }
+      // a shorter file (e.g. of another build) would fault when read through the mapping
+      struct stat st;
+      void *map = MAP_FAILED;
+      if (fstat (fd, &st) == 0 && st.st_size >= (off_t) sizeof (ProgressRecord))
+        {
+          map = mmap (NULL, sizeof (ProgressRecord), PROT_READ, MAP_SHARED, fd, 0);
+        }
+      close (fd);
+      if (map == MAP_FAILED)
+        {
+          continue;
+        }
+      const ProgressRecord *shared = (const ProgressRecord *) map;
+      ProgressRecord r;
+      uint64_t before;
+      do
+        {
+          before = __atomic_load_n (&shared->sequence, __ATOMIC_ACQUIRE);
+          std::memcpy (&r, shared, sizeof (r));
+          std::atomic_thread_fence (std::memory_order_acquire);
+        }
+      while (before % 2 == 1 || __atomic_load_n (&shared->sequence, __ATOMIC_RELAXED) != before);
+      munmap (map, sizeof (ProgressRecord));
+      if (r.pid == 0 || (kill (r.pid, 0) != 0 && errno == ESRCH))
+        {
+          unlink (path.c_str ()); // process has ended (workers end without removing their records)
+          continue;
+        }
+      r.name[sizeof (r.name) - 1] = 0;
+      records.push_back (r);
+    }
+  closedir (d);
+  std::sort (records.begin (), records.end (), [] (const ProgressRecord &a, const ProgressRecord &b) { return a.pid < b.pid; });
+  return records;
+}
+
+std::string
+ProgressMonitor::FormatTime (double seconds)
+{
+  uint64_t s = std::max (0.0, seconds) + 0.5;
+  std::ostringstream oss;
+  oss << s / 3600 << ":" << std::setw (2) << std::setfill ('0') << s / 60 % 60 << ":" << std::setw (2) << s % 60;
+  return oss.str ();
+}
+
+void
+ProgressMonitor::Print (const std::vector<ProgressRecord> &records)
+{
+  std::cout << std::setw (8) << "pid" << std::setw (6) << "run" << std::setw (16) << "sim time [s]"
+            << std::setw (9) << "sim/wall" << std::setw (12) << "events/s" << std::setw (10) << "queue"
+            << std::setw (9) << "RSS [MB]" << std::setw (10) << "wall" << std::setw (10) << "ETA" << "  experiment" << std::endl;
+  for (std::vector<ProgressRecord>::const_iterator r = records.begin (); r != records.end (); ++r)
+    {
+      std::ostringstream sim;
+      sim << std::fixed << std::setprecision (0) << r->simTime << "/" << r->stopTime;
+      std::cout << std::setw (8) << r->pid;
+      if (r->state == ProgressRecord::IDLE)
+        {
+          std::cout << std::setw (6) << "-" << std::setw (16) << "idle" << std::setw (9) << "" << std::setw (12) << ""
+                    << std::setw (10) << "" << std::setw (9) << std::fixed << std::setprecision (0) << r->peakRssMb << std::endl;
+          continue;
+        }
+      std::cout << std::setw (6) << r->rngRun << std::setw (16) << sim.str ()
+                << std::setw (9) << std::fixed << std::setprecision (2) << r->ratio
+                << std::setw (12) << std::setprecision (0) << r->eventsPerSecond
+                << std::setw (10) << r->queueSize << std::setw (9) << r->peakRssMb
+                << std::setw (10) << FormatTime (r->wallTime) << std::setw (10) << FormatTime (r->eta)
+                << "  " << r->name << std::endl;
+    }
+  std::cout << std::endl;
+}
+
+int
+ProgressMonitor::Run (std::string dir, double interval)
+{
+  bool seen = false;
+  while (true)
+    {
+      std::vector<ProgressRecord> records = Read (dir);
+      if (records.empty ())
+        {
+          if (seen)
+            {
+              return 0;
+            }
+          std::cout << "Waiting for runs in " << dir << std::endl;
+        }
+      else
+        {
+          seen = true;
+          Print (records);
+        }
+      std::this_thread::sleep_for (std::chrono::duration<double> (interval));
+    }
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_PROGRESS_H */
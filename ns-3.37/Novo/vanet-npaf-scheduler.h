@@ -0,0 +1,412 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Timing wheel scheduler for vanet-npaf.cc
+
+  Most events of a VANET simulation are a few microseconds after "now" (OFDM symbols,
+  slots, SIFS/AIFS, propagation delay), the rest are timers of tens of milliseconds to
+  seconds (AODV hello, applications). TimingWheelScheduler keeps events in four wheels
+  of 256 slots each; with the default nanosecond resolution a slot of the first wheel is
+  1.024 us (the first wheel covers 262 us), of the second 262 us (67 ms), of the third
+  67 ms (17 s) and of the fourth 17 s (73 minutes). Events further away are kept in a map.
+
+  An event goes to the lowest wheel whose range still contains it, in O(1). When all
+  slots of a wheel up to the end of its range are empty, the next slot of the higher wheel
+  is spread over the lower wheels, so every event is moved at most four times. Events of
+  the current slot of the first wheel are kept in a heap, so events are removed in the
+  same order (time, then uid) as by the other ns-3 schedulers and results do not change.
+  A canceled event in the heap is only marked (its uid is kept in a set) and dropped when
+  it reaches the top, so Remove takes O(1) instead of searching and rebuilding the heap.
+
+  ObservedScheduler passes everything to another scheduler and counts events in the
+  queue, which ns-3 does not tell; the progress reporter shows the count. With the
+  Profile attribute it also tells every removed event to an EventProfile.
+*/
+
+#ifndef VANET_NPAF_SCHEDULER_H
+#define VANET_NPAF_SCHEDULER_H
+
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+#include <vector>
+
+#include "ns3/core-module.h"
+
+#include "vanet-npaf-profile.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class TimingWheelScheduler
+// hierarchical timing wheel
+/////////////////////////////////////////////
+class TimingWheelScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId ();
+  TimingWheelScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty () const;
+  virtual Event PeekNext () const;
+  virtual Event RemoveNext ();
+  virtual void Remove (const Event &ev);
+
+private:
+  static const uint32_t LEVELS = 4;
+  static const uint32_t BITS = 8; // 256 slots in a wheel
+  static const uint32_t SLOTS = 1 << BITS;
+  static const uint32_t SHIFT = 10; // slot of the first wheel is 2^10 time units
+
+  static uint32_t Shift (uint32_t level) { return SHIFT + level * BITS; }; // slot of the wheel is 2^Shift time units
+  static bool Later (const Event &a, const Event &b) { return b.key < a.key; }; // heap of the earliest event
+
+  void Place (const Event &ev); // into the heap, a wheel or the map, relative to m_start
+  bool Find (uint32_t level, uint32_t from, uint32_t &slot) const; // first slot with events, from "from" to the end of the wheel
+  void Advance (); // until the heap has events, if there are any
+  void Purge (); // removed events at the top of the heap are dropped, then Advance
+
+  uint64_t m_start; // beginning of the slot of the first wheel whose events are in the heap
+  std::vector<Event> m_current; // heap, events before the end of m_start slot
+  std::unordered_set<uint32_t> m_removed; // uids of removed events still in m_current, never at its top
+  std::vector<Event> m_wheels[LEVELS][SLOTS];
+  uint64_t m_used[LEVELS][SLOTS / 64]; // bit for every slot with events
+  std::map<EventKey, EventImpl *> m_far; // beyond the fourth wheel
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TimingWheelScheduler);
+
+TypeId
+TimingWheelScheduler::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::TimingWheelScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<TimingWheelScheduler> ();
+  return tid;
+}
+
+TimingWheelScheduler::TimingWheelScheduler ()
+  : m_start (0)
+{
+  std::fill (&m_used[0][0], &m_used[0][0] + LEVELS * SLOTS / 64, 0);
+}
+
+void
+TimingWheelScheduler::Place (const Event &ev)
+{
+  uint64_t ts = ev.key.m_ts;
+  // events before m_start are inserted only when the heap has already moved beyond "now"; they are still before all events in the wheels
+  if (ts < m_start + (1ULL << SHIFT))
+    {
+      m_current.push_back (ev);
+      std::push_heap (m_current.begin (), m_current.end (), &TimingWheelScheduler::Later);
+      return;
+    }
+  for (uint32_t level = 0; level < LEVELS; level++)
+    {
+      if ((ts >> Shift (level + 1)) == (m_start >> Shift (level + 1)))
+        {
+          uint32_t slot = (ts >> Shift (level)) & (SLOTS - 1);
+          m_wheels[level][slot].push_back (ev);
+          m_used[level][slot / 64] |= 1ULL << (slot % 64);
+          return;
+        }
+    }
+  m_far.insert (std::make_pair (ev.key, ev.impl));
+}
+
+bool
+TimingWheelScheduler::Find (uint32_t level, uint32_t from, uint32_t &slot) const
+{
+  for (uint32_t w = from / 64; w < SLOTS / 64; w++)
+    {
+      uint64_t used = m_used[level][w];
+      if (w == from / 64)
+        {
+          used &= ~0ULL << (from % 64);
+        }
+      if (used != 0)
+        {
+          slot = w * 64 + __builtin_ctzll (used);
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+TimingWheelScheduler::Advance ()
+{
+  while (m_current.empty ())
+    {
+      bool found = false;
+      for (uint32_t level = 0; level < LEVELS && !found; level++)
+        {
+          uint32_t slot;
+          // the slot of m_start has no events, they are in lower wheels
+          if (!Find (level, ((m_start >> Shift (level)) & (SLOTS - 1)) + 1, slot))
+            {
+              continue;
+            }
+          found = true;
+          m_start = ((m_start >> Shift (level + 1)) << Shift (level + 1)) | ((uint64_t) slot << Shift (level));
+          std::vector<Event> events;
+          events.swap (m_wheels[level][slot]);
+          m_used[level][slot / 64] &= ~(1ULL << (slot % 64));
+          for (std::vector<Event>::const_iterator e = events.begin (); e != events.end (); ++e)
+            {
+              Place (*e);
+            }
+          // the vector keeps its capacity for the next use of the slot
+          events.clear ();
+          m_wheels[level][slot].swap (events);
+        }
+      if (found)
+        {
+          continue;
+        }
+      if (m_far.empty ())
+        {
+          return;
+        }
+      // wheels are empty: they move to the earliest distant event
+      m_start = (m_far.begin ()->first.m_ts >> SHIFT) << SHIFT;
+      uint64_t range = m_start >> Shift (LEVELS);
+      while (!m_far.empty () && (m_far.begin ()->first.m_ts >> Shift (LEVELS)) == range)
+        {
+          Event ev;
+          ev.key = m_far.begin ()->first;
+          ev.impl = m_far.begin ()->second;
+          m_far.erase (m_far.begin ());
+          Place (ev);
+        }
+    }
+}
+
+void
+TimingWheelScheduler::Purge ()
+{
+  // events moved into the heap by Advance come from the wheels, where removed events are erased at once
+  while (!m_current.empty () && !m_removed.empty () && m_removed.erase (m_current.front ().key.m_uid) != 0)
+    {
+      std::pop_heap (m_current.begin (), m_current.end (), &TimingWheelScheduler::Later);
+      m_current.pop_back ();
+    }
+  Advance ();
+}
+
+void
+TimingWheelScheduler::Insert (const Event &ev)
+{
+  Place (ev);
+  Advance ();
+}
+
+bool
+TimingWheelScheduler::IsEmpty () const
+{
+  return m_current.empty ();
+}
+
+Scheduler::Event
+TimingWheelScheduler::PeekNext () const
+{
+  NS_ASSERT (!m_current.empty ());
+  return m_current.front ();
+}
+
+Scheduler::Event
+TimingWheelScheduler::RemoveNext ()
+{
+  NS_ASSERT (!m_current.empty ());
+  std::pop_heap (m_current.begin (), m_current.end (), &TimingWheelScheduler::Later);
+  Event ev = m_current.back ();
+  m_current.pop_back ();
+  Purge ();
+  return ev;
+}
+
+void
+TimingWheelScheduler::Remove (const Event &ev)
+{
+  // the event is where Place would put it now
+  uint64_t ts = ev.key.m_ts;
+  if (ts < m_start + (1ULL << SHIFT))
+    {
+      // left in the heap until it reaches the top; the impl may be deleted, only the key is read
+      m_removed.insert (ev.key.m_uid);
+      Purge ();
+      return;
+    }
+  for (uint32_t level = 0; level < LEVELS; level++)
+    {
+      if ((ts >> Shift (level + 1)) == (m_start >> Shift (level + 1)))
+        {
+          uint32_t slot = (ts >> Shift (level)) & (SLOTS - 1);
+          std::vector<Event> &events = m_wheels[level][slot];
+          for (std::vector<Event>::iterator e = events.begin (); e != events.end (); ++e)
+            {
+              if (e->key.m_uid == ev.key.m_uid)
+                {
+                  *e = events.back ();
+                  events.pop_back ();
+                  if (events.empty ())
+                    {
+                      m_used[level][slot / 64] &= ~(1ULL << (slot % 64));
+                    }
+                  return;
+                }
+            }
+          NS_ASSERT_MSG (false, "Event not found");
+          return;
+        }
+    }
+  m_far.erase (ev.key);
+}
+
+/////////////////////////////////////////////
+// class ObservedScheduler
+// another scheduler, with the number of events in the queue
+/////////////////////////////////////////////
+class ObservedScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId ();
+  ObservedScheduler ();
+  virtual ~ObservedScheduler ();
+
+  static uint64_t GetSize (); // events in the queue of the current simulation, 0 if it has another scheduler
+  static EventProfile *GetProfile (); // of the current simulation, 0 if it is not profiled
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty () const;
+  virtual Event PeekNext () const;
+  virtual Event RemoveNext ();
+  virtual void Remove (const Event &ev);
+
+private:
+  void SetScheduler (std::string type);
+
+  Ptr<Scheduler> m_scheduler;
+  uint64_t m_size;
+  bool m_profiling;
+  EventProfile m_profile;
+  static ObservedScheduler *m_current; // the last one made; the simulator has one scheduler at a time
+};
+
+ObservedScheduler *ObservedScheduler::m_current = 0;
+
+NS_OBJECT_ENSURE_REGISTERED (ObservedScheduler);
+
+TypeId
+ObservedScheduler::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::ObservedScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<ObservedScheduler> ()
+    .AddAttribute ("Scheduler", "Type of the scheduler that keeps the events.",
+                   StringValue ("ns3::MapScheduler"),
+                   MakeStringAccessor (&ObservedScheduler::SetScheduler),
+                   MakeStringChecker ())
+    .AddAttribute ("Profile", "Count events and measure their wall clock time by type.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&ObservedScheduler::m_profiling),
+                   MakeBooleanChecker ());
+  return tid;
+}
+
+ObservedScheduler::ObservedScheduler ()
+  : m_size (0),
+    m_profiling (false)
+{
+  m_current = this;
+}
+
+ObservedScheduler::~ObservedScheduler ()
+{
+  if (m_current == this)
+    {
+      m_current = 0;
+    }
+}
+
+void
+ObservedScheduler::SetScheduler (std::string type)
+{
+  NS_ASSERT (m_size == 0);
+  ObjectFactory factory (type);
+  m_scheduler = factory.Create<Scheduler> ();
+}
+
+uint64_t
+ObservedScheduler::GetSize ()
+{
+  return m_current == 0 ? 0 : m_current->m_size;
+}
+
+EventProfile *
+ObservedScheduler::GetProfile ()
+{
+  return m_current == 0 || !m_current->m_profiling ? 0 : &m_current->m_profile;
+}
+
+void
+ObservedScheduler::Insert (const Event &ev)
+{
+  m_size++;
+  m_scheduler->Insert (ev);
+}
+
+bool
+ObservedScheduler::IsEmpty () const
+{
+  return m_scheduler->IsEmpty ();
+}
+
+Scheduler::Event
+ObservedScheduler::PeekNext () const
+{
+  return m_scheduler->PeekNext ();
+}
+
+Scheduler::Event
+ObservedScheduler::RemoveNext ()
+{
+  m_size--;
+  Event ev = m_scheduler->RemoveNext ();
+  if (m_profiling)
+    {
+      m_profile.Next (ev.impl);
+    }
+  return ev;
+}
+
+void
+ObservedScheduler::Remove (const Event &ev)
+{
+  m_size--;
+  m_scheduler->Remove (ev);
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_SCHEDULER_H */
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Wall clock time of one run of the semafor scenarios (trace and generated mobility)
+# with every event scheduler: 0=Map; 1=Heap; 2=Calendar; 3=TimingWheel
+# All schedulers remove events in the same order, so summaries must be equal
+
+# Name of the script (.cc file in the scratch folder)
+PROGRAM_NAME="vanet-npaf"
+
+# Short run of the scenario, its summary goes to Sched*-*-Summary.csv
+OPTIONS="--nNodes=350 --nSources=10 --simTime=100 --startupTime=50 --startRngRun=1 --stopRngRun=1 --workers=1 --cacheDir="
+
+for SCENARIO in 2 3
+do
+  for SCHEDULER in 0 1 2 3
+  do
+    echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+    echo x   "./ns3 run \"$PROGRAM_NAME $OPTIONS --scenario=$SCENARIO --scheduler=$SCHEDULER --csvFileNamePrefix=Sched$SCHEDULER\""
+    echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+    /usr/bin/time -f "scenario $SCENARIO scheduler $SCHEDULER: %e s, %M kB" ./ns3 run "$PROGRAM_NAME $OPTIONS --scenario=$SCENARIO --scheduler=$SCHEDULER --csvFileNamePrefix=Sched$SCHEDULER" 2>&1 | grep "scheduler $SCHEDULER:"
+  done
+done
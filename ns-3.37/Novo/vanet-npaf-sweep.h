@@ -0,0 +1,379 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Parameter sweeps for vanet-npaf.cc
+
+  ParameterSweep reads a sweep specification and expands it into points, each point
+  being a list of command line arguments (--name=value) for RoutingExperiment. Any
+  option of the program can be an axis. Example of a specification file:
+
+    # lines starting with # are comments
+    design factorial          # factorial (every combination) or lhs (Latin hypercube)
+    samples 20                # number of points for lhs design
+    seed 1                    # lhs design is random, but repeatable for the same seed
+    runs 1 200                # RngRuns simulated for every point
+    fixed scenario 2          # same value for every point
+    axis routingProtocol 1 2 3
+    axis nNodes 50 100 150 200
+    axis dataRate 4kbps 10kbps
+    range txp 15 25           # continuous axis, only for lhs design
+
+  Latin hypercube design divides every axis into "samples" equally probable strata and
+  uses every stratum exactly once, so the whole space is covered with far fewer points
+  than the factorial design. Samples are drawn from mt19937_64, whose output is the same
+  in every standard library, without std::shuffle and std distributions, whose
+  algorithms are not; so a seed gives the same points everywhere.
+*/
+
+#ifndef VANET_NPAF_SWEEP_H
+#define VANET_NPAF_SWEEP_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// class ParameterSweep
+// sweep specification expanded into points (lists of command line arguments)
+/////////////////////////////////////////////
+class ParameterSweep
+{
+public:
+  ParameterSweep ();
+
+  bool Load (std::string fileName); // returns false and sets error message if specification is not valid
+  std::string GetError () const { return m_error; };
+
+  std::vector<std::vector<std::string> > GetPoints () const; // arguments like --nNodes=50 for every point
+  std::vector<std::string> GetAxisNames () const; // options that differ between points
+  bool HasRuns () const { return m_hasRuns; };
+  uint64_t GetStartRngRun () const { return m_startRngRun; };
+  uint64_t GetStopRngRun () const { return m_stopRngRun; };
+
+private:
+  struct Axis
+  {
+    std::string name;
+    std::vector<std::string> values; // levels of discrete axis
+    bool continuous; // range axis
+    double min;
+    double max;
+    bool integer; // range of integer option
+  };
+
+  std::vector<std::vector<std::string> > Factorial () const;
+  std::vector<std::vector<std::string> > LatinHypercube () const;
+  static std::string Argument (const std::string &name, const std::string &value);
+  static bool ToUnsigned (const std::string &token, uint64_t &value); // false if the whole token is not a number
+  static bool ToDouble (const std::string &token, double &value);
+
+  std::string m_design;
+  uint32_t m_samples;
+  uint32_t m_seed;
+  bool m_hasRuns;
+  uint64_t m_startRngRun;
+  uint64_t m_stopRngRun;
+  std::vector<std::string> m_fixed; // arguments common for all points
+  std::vector<Axis> m_axes;
+  std::string m_error;
+};
+
+ParameterSweep::ParameterSweep ()
+  : m_design ("factorial"),
+    m_samples (0),
+    m_seed (1),
+    m_hasRuns (false),
+    m_startRngRun (1),
+    m_stopRngRun (1)
+{
+}
+
+std::string
+ParameterSweep::Argument (const std::string &name, const std::string &value)
+{
+  return "--" + name + "=" + value;
+}
+
+bool
+ParameterSweep::ToUnsigned (const std::string &token, uint64_t &value)
+{
+  if (token.empty () || token.find_first_not_of ("0123456789") != std::string::npos)
+    {
+      return false;
+    }
+  try
+    {
+      value = std::stoull (token);
+    }
+  catch (const std::out_of_range &)
+    {
+      return false;
+    }
+  return true;
+}
+
+bool
+ParameterSweep::ToDouble (const std::string &token, double &value)
+{
+  std::size_t used = 0;
+  try
+    {
+      value = std::stod (token, &used);
+    }
+  catch (const std::logic_error &) // invalid_argument or out_of_range
+    {
+      return false;
+    }
+  return used == token.size ();
+}
+
+bool
+ParameterSweep::Load (std::string fileName)
+{
+  std::ifstream file (fileName.c_str ());
+  if (!file.is_open ())
+    {
+      m_error = "can not open " + fileName;
+      return false;
+    }
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline (file, line))
+    {
+      lineNumber++;
+      line = line.substr (0, line.find ('#'));
+      std::istringstream ss (line);
+      std::string keyword;
+      if (!(ss >> keyword))
+        {
+          continue; // empty line or comment
+        }
+      std::vector<std::string> args;
+      std::string a;
+      while (ss >> a)
+        {
+          args.push_back (a);
+        }
+      std::string where = fileName + ":" + std::to_string (lineNumber) + ": ";
+      // numbers expected by the keyword
+      std::vector<std::string> numbers;
+      if (keyword == "samples" || keyword == "seed" || keyword == "runs")
+        {
+          numbers = args;
+        }
+      else if (keyword == "range" && args.size () == 3)
+        {
+          numbers.assign (args.begin () + 1, args.end ());
+        }
+      std::vector<double> values;
+      for (std::vector<std::string>::const_iterator n = numbers.begin (); n != numbers.end (); ++n)
+        {
+          uint64_t u;
+          double d;
+          if (keyword == "range" ? !ToDouble (*n, d) : !ToUnsigned (*n, u))
+            {
+              m_error = where + "bad number \"" + *n + "\" in: " + line;
+              return false;
+            }
+          values.push_back (keyword == "range" ? d : u);
+        }
+
+      if (keyword == "design" && args.size () == 1 && (args[0] == "factorial" || args[0] == "lhs"))
+        {
+          m_design = args[0];
+        }
+      else if (keyword == "samples" && args.size () == 1)
+        {
+          m_samples = values[0];
+        }
+      else if (keyword == "seed" && args.size () == 1)
+        {
+          m_seed = values[0];
+        }
+      else if (keyword == "runs" && args.size () == 2)
+        {
+          m_hasRuns = true;
+          ToUnsigned (args[0], m_startRngRun); // exact, beyond the precision of double
+          ToUnsigned (args[1], m_stopRngRun);
+          if (m_startRngRun > m_stopRngRun)
+            {
+              m_error = where + "first run number must be less or equal to last";
+              return false;
+            }
+        }
+      else if (keyword == "fixed" && args.size () == 2)
+        {
+          m_fixed.push_back (Argument (args[0], args[1]));
+        }
+      else if (keyword == "axis" && args.size () >= 2)
+        {
+          Axis axis;
+          axis.name = args[0];
+          axis.values.assign (args.begin () + 1, args.end ());
+          axis.continuous = false;
+          axis.min = axis.max = 0;
+          axis.integer = false;
+          m_axes.push_back (axis);
+        }
+      else if (keyword == "range" && args.size () == 3)
+        {
+          Axis axis;
+          axis.name = args[0];
+          axis.continuous = true;
+          axis.min = values[0];
+          axis.max = values[1];
+          // range written with integers is range of an integer option (e.g. nNodes)
+          axis.integer = args[1].find_first_not_of ("-0123456789") == std::string::npos
+                         && args[2].find_first_not_of ("-0123456789") == std::string::npos;
+          m_axes.push_back (axis);
+        }
+      else
+        {
+          m_error = where + "unknown or incomplete line: " + line;
+          return false;
+        }
+    }
+
+  if (m_design == "lhs" && m_samples == 0)
+    {
+      m_error = fileName + ": lhs design needs number of samples";
+      return false;
+    }
+  if (m_design == "factorial")
+    {
+      for (std::vector<Axis>::const_iterator axis = m_axes.begin (); axis != m_axes.end (); ++axis)
+        {
+          if (axis->continuous)
+            {
+              m_error = fileName + ": range axis " + axis->name + " can be used only with lhs design";
+              return false;
+            }
+        }
+    }
+  return true;
+}
+
+std::vector<std::string>
+ParameterSweep::GetAxisNames () const
+{
+  std::vector<std::string> names;
+  for (std::vector<Axis>::const_iterator axis = m_axes.begin (); axis != m_axes.end (); ++axis)
+    {
+      names.push_back (axis->name);
+    }
+  return names;
+}
+
+std::vector<std::vector<std::string> >
+ParameterSweep::GetPoints () const
+{
+  std::vector<std::vector<std::string> > axes = m_design == "lhs" ? LatinHypercube () : Factorial ();
+
+  // the same point can be sampled more than once with discrete axes, it is simulated only once
+  std::vector<std::vector<std::string> > points;
+  std::set<std::vector<std::string> > seen;
+  for (std::vector<std::vector<std::string> >::const_iterator p = axes.begin (); p != axes.end (); ++p)
+    {
+      if (seen.insert (*p).second)
+        {
+          std::vector<std::string> point = m_fixed;
+          point.insert (point.end (), p->begin (), p->end ());
+          points.push_back (point);
+        }
+    }
+  return points;
+}
+
+std::vector<std::vector<std::string> >
+ParameterSweep::Factorial () const
+{
+  std::vector<std::vector<std::string> > points (1);
+  for (std::vector<Axis>::const_iterator axis = m_axes.begin (); axis != m_axes.end (); ++axis)
+    {
+      std::vector<std::vector<std::string> > extended;
+      for (std::vector<std::vector<std::string> >::const_iterator p = points.begin (); p != points.end (); ++p)
+        {
+          for (std::vector<std::string>::const_iterator v = axis->values.begin (); v != axis->values.end (); ++v)
+            {
+              extended.push_back (*p);
+              extended.back ().push_back (Argument (axis->name, *v));
+            }
+        }
+      points = extended;
+    }
+  return points;
+}
+
+std::vector<std::vector<std::string> >
+ParameterSweep::LatinHypercube () const
+{
+  std::mt19937_64 rng (m_seed);
+  auto uniform = [&rng] () { return (rng () >> 11) * (1.0 / 9007199254740992.0); }; // 53 bits, [0, 1)
+  std::vector<std::vector<std::string> > points (m_samples);
+  for (std::vector<Axis>::const_iterator axis = m_axes.begin (); axis != m_axes.end (); ++axis)
+    {
+      // stratum of every sample on this axis
+      std::vector<uint32_t> strata (m_samples);
+      for (uint32_t i = 0; i < m_samples; i++)
+        {
+          strata[i] = i;
+        }
+      // Fisher-Yates; bias of the modulo is below 2^-32 for any realistic number of samples
+      for (uint32_t i = m_samples; i > 1; i--)
+        {
+          std::swap (strata[i - 1], strata[rng () % i]);
+        }
+
+      for (uint32_t i = 0; i < m_samples; i++)
+        {
+          std::string value;
+          if (axis->continuous)
+            {
+              double x = axis->min + (strata[i] + uniform ()) / m_samples * (axis->max - axis->min);
+              std::ostringstream ss;
+              if (axis->integer)
+                ss << std::llround (x);
+              else
+                ss << x;
+              value = ss.str ();
+            }
+          else
+            {
+              // equal number of strata for every level
+              value = axis->values[(uint64_t) strata[i] * axis->values.size () / m_samples];
+            }
+          points[i].push_back (Argument (axis->name, value));
+        }
+    }
+  return points;
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_SWEEP_H */
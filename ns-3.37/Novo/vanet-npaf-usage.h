@@ -0,0 +1,91 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Resource usage of simulation runs for vanet-npaf.cc
+
+  RunMetrics is what one run cost: wall clock time of the setup (building nodes, devices,
+  applications) and of the event loop, CPU time, executed events and peak memory. Runs
+  are simulated one after another in the same worker process, so the peak is reset at
+  the start of every run (Linux 4.0 and later, /proc/self/clear_refs); on other systems
+  it is the peak of the process so far.
+*/
+
+#ifndef VANET_NPAF_USAGE_H
+#define VANET_NPAF_USAGE_H
+
+#include <cstdint>
+#include <fstream>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+namespace ns3 {
+
+/////////////////////////////////////////////
+// struct RunMetrics
+// resources used by one run
+/////////////////////////////////////////////
+struct RunMetrics
+{
+  double setupTime = 0.0; // [s] wall clock time from the start of the run to the first event
+  double loopTime = 0.0; // [s] wall clock time of the event loop
+  double cpuTime = 0.0; // [s] user and system time of the run
+  uint64_t events = 0; // executed events
+  double simTime = 0.0; // [s] simulated time
+  double peakRssMb = 0.0; // peak resident memory of the process during the run
+};
+
+/////////////////////////////////////////////
+// class ResourceUsage
+// CPU time and memory of this process
+/////////////////////////////////////////////
+class ResourceUsage
+{
+public:
+  static double GetCpuTime (); // [s] user and system time of the process so far
+  static void ResetPeakRss (); // the peak becomes the current resident memory
+  static double GetPeakRssMb ();
+};
+
+double
+ResourceUsage::GetCpuTime ()
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void
+ResourceUsage::ResetPeakRss ()
+{
+  std::ofstream clear ("/proc/self/clear_refs");
+  clear << "5";
+}
+
+double
+ResourceUsage::GetPeakRssMb ()
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0; // kB on Linux
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_USAGE_H */
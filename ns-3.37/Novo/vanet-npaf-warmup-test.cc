@@ -0,0 +1,102 @@
+// Checks of MSER-5 warm-up detection (vanet-npaf-warmup.h) on series with known transients
+// ./ns3 run vanet-npaf-warmup-test; exit status is 0 when all checks pass
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "vanet-npaf-warmup.h"
+
+using namespace ns3;
+
+namespace {
+
+uint32_t g_failures = 0;
+
+void
+Check (bool ok, const std::string &what)
+{
+  std::cout << (ok ? "PASS " : "FAIL ") << what << std::endl;
+  if (!ok)
+    {
+      g_failures++;
+    }
+}
+
+// noise in [-1, 1), the same in every run
+double
+Noise (uint64_t &state)
+{
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (state >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+
+// level approaches 10 with time constant tau [samples]
+std::vector<double>
+Series (uint32_t n, double tau, uint64_t seed)
+{
+  std::vector<double> series;
+  uint64_t state = seed;
+  for (uint32_t t = 1; t <= n; t++)
+    {
+      double level = tau > 0 ? 10.0 * (1.0 - std::exp (-(double) t / tau)) : 10.0;
+      series.push_back (level + Noise (state));
+    }
+  return series;
+}
+
+// number of samples after which WarmupDetector would finish, 0 = never
+uint32_t
+Detect (const std::vector<double> &series)
+{
+  for (uint32_t t = 1; t <= series.size (); t++)
+    {
+      if (WarmupDetector::IsSteady (std::vector<double> (series.begin (), series.begin () + t)))
+        {
+          return t;
+        }
+    }
+  return 0;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  // a stable series is not accepted before MIN_BATCHES batches
+  std::vector<double> flat = Series (400, 0.0, 1);
+  Check (!WarmupDetector::IsSteady (std::vector<double> (flat.begin (), flat.begin () + 30)), "6 batches are never steady");
+  Check (Detect (flat) == 5 * WarmupDetector::MIN_BATCHES, "stable series is steady after MIN_BATCHES batches");
+
+  // long transient (time constant 40 samples, within 1% of the level after about 185 samples)
+  std::vector<double> transient = Series (600, 40.0, 2);
+  uint32_t detected = Detect (transient);
+  Check (detected > 5 * WarmupDetector::MIN_BATCHES, "long transient is detected later than MIN_BATCHES batches");
+  uint32_t truncation = Mser5Truncation (std::vector<double> (transient.begin (), transient.begin () + detected));
+  Check (truncation >= 100, "truncation point drops most of the transient");
+  std::cout << "long transient: steady after " << detected << " samples, truncation point " << truncation << std::endl;
+
+  // defaults of vanet-npaf: minimum warm-up 30 s, startupTime (maximum warm-up) 100 s;
+  // routing and density settle with a time constant of 10 s
+  double interval = WarmupDetector::GetInterval (30.0);
+  Check (std::fabs (interval * 5 * WarmupDetector::MIN_BATCHES - 30.0) < 1e-9, "MIN_BATCHES batches take the minimum warm-up");
+  std::vector<double> network = Series (100.0 / interval, 10.0 / interval, 4);
+  uint32_t samples = Detect (network);
+  double seconds = samples * interval;
+  Check (samples != 0 && seconds < 100.0, "at defaults steady state is detected before the maximum warm-up");
+  Check (seconds >= 30.0, "at defaults steady state is not detected before the minimum warm-up");
+  std::cout << "defaults: steady at " << seconds << " s" << std::endl;
+
+  // a transient that never ends is never steady
+  std::vector<double> ramp;
+  uint64_t state = 3;
+  for (uint32_t t = 1; t <= 400; t++)
+    {
+      ramp.push_back (0.1 * t + Noise (state));
+    }
+  Check (Detect (ramp) == 0, "linear ramp is never steady");
+
+  return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 University of Belgrade
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  Warm-up detection for vanet-npaf.cc
+
+  WarmupDetector watches the network before applications start. At regular intervals
+  it records two metrics: the number of frames sent by all PHYs (before applications
+  start this is only routing control traffic) and the average number of neighbours
+  of a node (mobility density). Steady state is reached when the MSER-5 truncation
+  point of both series lies in the first half of the data collected so far, i.e.
+  the initial transient is over and it is followed by at least as much stable data.
+  Then the callback is called; it is called at the maximum warm-up time anyway.
+
+  With a few batches MSER-5 can only truncate 0 or 5 observations, which always lies
+  in the first half, so a series is checked only when it has MIN_BATCHES batches. The
+  sampling interval is chosen so that MIN_BATCHES batches take the minimum warm-up
+  (30 s by default, 0.3 s per sample), so steady state can be detected from then on.
+  vanet-npaf-warmup-test.cc checks the detection on series with known transients.
+*/
+
+#ifndef VANET_NPAF_WARMUP_H
+#define VANET_NPAF_WARMUP_H
+
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+
+namespace ns3 {
+
+// MSER-5 truncation point: number of leading observations to drop (multiple of 5)
+// observations are averaged in batches of 5, truncation minimizes variance of the rest over its size squared;
+// at least 5 batches must remain, otherwise 0 is returned
+inline uint32_t
+Mser5Truncation (const std::vector<double> &obs)
+{
+  uint32_t n = obs.size () / 5;
+  std::vector<double> batch (n, 0.0);
+  for (uint32_t i = 0; i < n * 5; i++)
+    {
+      batch[i / 5] += obs[i] / 5.0;
+    }
+  uint32_t best = 0;
+  double bestMser = std::numeric_limits<double>::max ();
+  // suffix sums give mean and variance of batches d..n-1 for every d
+  double sum = 0.0;
+  double sumSq = 0.0;
+  for (uint32_t d = n; d-- > 0; )
+    {
+      sum += batch[d];
+      sumSq += batch[d] * batch[d];
+      uint32_t m = n - d;
+      if (m < 5)
+        {
+          continue; // variance of the last few batches is not reliable
+        }
+      double mser = (sumSq - sum * sum / m) / ((double) m * m);
+      if (mser <= bestMser)
+        {
+          bestMser = mser;
+          best = d;
+        }
+    }
+  return best * 5;
+}
+
+/////////////////////////////////////////////
+// class WarmupDetector
+// calls back when routing traffic and node density have stabilized
+/////////////////////////////////////////////
+class WarmupDetector
+{
+public:
+  WarmupDetector (NodeContainer nodes, double maxWarmup, std::function<void ()> steady);
+
+  void SetNeighbourRange (double range) { m_range = range; };
+  void SetMinWarmup (double minWarmup) { m_minWarmup = minWarmup; }; // before Start
+  void Start (); // connects traces and starts sampling, call before Simulator::Run
+
+  static const uint32_t MIN_BATCHES = 20; // of 5 observations, before truncation is accepted
+  static bool IsSteady (const std::vector<double> &series); // truncation point in the first half, enough batches
+  static double GetInterval (double minWarmup) { return minWarmup / (5 * MIN_BATCHES); }; // [s] between samples
+
+private:
+  void PhyTx (Ptr<const Packet> packet, double txPowerW);
+  void Sample ();
+  double GetAverageDegree ();
+  void Finish ();
+
+  NodeContainer m_nodes;
+  double m_maxWarmup; // [s] callback is called at this time at the latest
+  double m_minWarmup; // [s] shortest series checked by MSER-5
+  double m_interval; // [s] between samples
+  double m_range; // [m] nodes closer than this are neighbours
+  std::function<void ()> m_steady;
+  std::vector<Ptr<WifiPhy> > m_phys; // with connected PhyTxBegin
+  bool m_finished;
+  uint64_t m_phyTx; // frames in the current interval
+  std::vector<double> m_txRate;
+  std::vector<double> m_degree;
+};
+
+WarmupDetector::WarmupDetector (NodeContainer nodes, double maxWarmup, std::function<void ()> steady)
+  : m_nodes (nodes),
+    m_maxWarmup (maxWarmup),
+    m_minWarmup (30.0),
+    m_interval (0.0),
+    m_range (300.0),
+    m_steady (steady),
+    m_finished (false),
+    m_phyTx (0)
+{
+}
+
+void
+WarmupDetector::Start ()
+{
+  for (NodeContainer::Iterator n = m_nodes.Begin (); n != m_nodes.End (); ++n)
+    {
+      for (uint32_t i = 0; i < (*n)->GetNDevices (); i++)
+        {
+          Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> ((*n)->GetDevice (i));
+          if (device != 0)
+            {
+              device->GetPhy ()->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&WarmupDetector::PhyTx, this));
+              m_phys.push_back (device->GetPhy ());
+            }
+        }
+    }
+  m_interval = GetInterval (m_minWarmup);
+  Simulator::Schedule (Seconds (m_interval), &WarmupDetector::Sample, this);
+  Simulator::Schedule (Seconds (m_maxWarmup), &WarmupDetector::Finish, this);
+}
+
+void
+WarmupDetector::PhyTx (Ptr<const Packet> packet, double txPowerW)
+{
+  m_phyTx++;
+}
+
+double
+WarmupDetector::GetAverageDegree ()
+{
+  std::vector<Vector> pos;
+  for (NodeContainer::Iterator n = m_nodes.Begin (); n != m_nodes.End (); ++n)
+    {
+      pos.push_back ((*n)->GetObject<MobilityModel> ()->GetPosition ());
+    }
+  double range2 = m_range * m_range;
+  uint64_t pairs = 0;
+  for (uint32_t i = 0; i < pos.size (); i++)
+    {
+      for (uint32_t j = i + 1; j < pos.size (); j++)
+        {
+          double dx = pos[i].x - pos[j].x;
+          double dy = pos[i].y - pos[j].y;
+          if (dx * dx + dy * dy < range2)
+            {
+              pairs++;
+            }
+        }
+    }
+  return pos.empty () ? 0.0 : 2.0 * pairs / pos.size ();
+}
+
+bool
+WarmupDetector::IsSteady (const std::vector<double> &series)
+{
+  return series.size () >= 5 * MIN_BATCHES && Mser5Truncation (series) * 2 <= series.size ();
+}
+
+void
+WarmupDetector::Sample ()
+{
+  if (m_finished)
+    {
+      return;
+    }
+  m_txRate.push_back (m_phyTx);
+  m_phyTx = 0;
+  m_degree.push_back (GetAverageDegree ());
+
+  if (IsSteady (m_txRate) && IsSteady (m_degree))
+    {
+      Finish ();
+      return;
+    }
+  Simulator::Schedule (Seconds (m_interval), &WarmupDetector::Sample, this);
+}
+
+void
+WarmupDetector::Finish ()
+{
+  if (m_finished)
+    {
+      return;
+    }
+  m_finished = true;
+  // frames of the rest of the run are not counted
+  for (std::vector<Ptr<WifiPhy> >::const_iterator phy = m_phys.begin (); phy != m_phys.end (); ++phy)
+    {
+      (*phy)->TraceDisconnectWithoutContext ("PhyTxBegin", MakeCallback (&WarmupDetector::PhyTx, this));
+    }
+  m_phys.clear ();
+  NS_LOG_UNCOND ("Warm-up finished at " << Simulator::Now ().GetSeconds () << " s");
+  m_steady ();
+}
+
+} // namespace ns3
+
+#endif /* VANET_NPAF_WARMUP_H */
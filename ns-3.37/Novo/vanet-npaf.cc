@@ -1,8 +1,15 @@
 #include <fstream>
 #include <iostream>
+#include <iomanip>
 #include <chrono>
 #include <ctime>    
+#include <map>
+#include <memory>
+#include <set>
 #include <vector>
+#include <algorithm>
+
+#include <sys/stat.h>
 
 #include "ns3/core-module.h"
 #include "ns3/nstime.h"
@@ -24,46 +31,162 @@
 #include "ns3/wifi-80211p-helper.h"
 #include "ns3/wave-mac-helper.h"
 
+#include "vanet-npaf-mobility.h"
+#include "vanet-npaf-grid.h"
+#include "vanet-npaf-channel.h"
+#include "vanet-npaf-fading.h"
+#include "vanet-npaf-error.h"
+#include "vanet-npaf-alloc.h"
+#include "vanet-npaf-scheduler.h"
+#include "vanet-npaf-usage.h"
+#include "vanet-npaf-farm.h"
+#include "vanet-npaf-sweep.h"
+#include "vanet-npaf-cache.h"
+#include "vanet-npaf-warmup.h"
+#include "vanet-npaf-progress.h"
+
 using namespace ns3;
 using namespace npaf;
 
 NS_LOG_COMPONENT_DEFINE ("VanetExample");
 
+// Parked vehicle (not in the mobility trace): its PHY sleeps, so it neither transmits nor gets
+// receive events from the channel. Only the channel work is saved: the interface stays up, so
+// routing timers (AODV hello, OLSR and DSDV updates), applications and MAC queue timeouts keep
+// scheduling events, and routing carries on when the PHY resumes (Ipv4::SetDown would stop AODV
+// hello messages for good). CutoffWifiChannel does not deliver to sleeping PHYs at all, while
+// YansWifiChannel delivers and they record the signal as interference, so right after waking up
+// a PHY on CutoffWifiChannel misses transmissions that started while it slept (at most one frame)
 void
-PrintCurrentTime ()
+SetVehicleActive (Ptr<NetDevice> device, bool active)
 {
-  std::ofstream file;
-  double time = Simulator::Now ().GetSeconds ();
-  if (time == 0.0)
-    file.open ("current-status.txt", std::ios::trunc);
+  Ptr<WifiPhy> phy = DynamicCast<WifiNetDevice> (device)->GetPhy ();
+  if (active)
+    {
+      phy->ResumeFromSleep ();
+    }
   else
-    file.open ("current-status.txt", std::ios::app);
-  file << time << " s\n";
-  file.close ();
-  Simulator::Schedule (Seconds (1), &PrintCurrentTime);
+    {
+      phy->SetSleepMode ();
+    }
 }
 
 /////////////////////////////////////////////
 // class RoutingExperiment
-// controls one program execution (run), holds data from current run
+// controls one program execution (one or more runs), holds data from current run
 /////////////////////////////////////////////
 class RoutingExperiment
 {
 public:
   RoutingExperiment (uint64_t stopRun = 1, std::string fn = "IJTTE"); // default is only one simulation run
   RoutingExperiment (uint64_t startRun, uint64_t stopRun, std::string fn = "IJTTE");
-  RunSummary Run (int argc, char **argv);
+  void Configure (int argc, char **argv); // parse command line arguments, must be called before Run
+  void Configure (const std::vector<std::string> &args); // same, args[0] is program name
+  RunSummary Run (); // one simulation run with current RngRun
+  RunResult Simulate (uint64_t run); // Run with given RngRun, measures its duration
   void WriteToSummaryFile (RunSummary srs);
+  void WriteSummaryFooter (); // statistics of all written runs, at the end of the summary file
+  bool WriteFailedRun (uint64_t run); // row of a run whose worker died, returns false when no more runs are needed
+  bool WriteResult (const RunResult &r); // one row of the summary file, returns false when no more runs are needed
+  void WriteBenchmark (const RunResult &r); // one row of the benchmark file
   void SetSimDuration (double simDur) { m_simDuration = simDur; };
 
+  void SetRngRun (uint64_t run) { m_rngRun = run; };
+  uint64_t GetRngRun () { return m_rngRun; };
+  uint64_t GetStartRngRun () { return m_startRngRun; };
+  uint64_t GetStopRngRun () { return m_stopRngRun; };
+  bool IsExternalRngRunControl () { return m_externalRngRunControl; };
+  uint32_t GetNWorkers () { return m_nWorkers; };
+  std::string GetSweepFile () { return m_sweepFile; };
+  std::string GetCsvFileNamePrefix () { return m_csvFileNamePrefix; };
+  double GetCostEstimate (); // relative duration of one run, used to start the longest runs first
+  void PrepareMobilityTrace (); // makes binary copy of the mobility trace, shared by all processes
+  std::string GetParameters (); // all parameters that affect results of a run, key of the result cache
+  std::string GetCacheDir () { return m_cacheDir; };
+  std::string GetCacheVersion () { return m_cacheVersion; };
+  std::string GetProgressDir () { return m_progressDir; };
+  bool IsMonitor () { return m_monitor; };
+
 private:
+  std::string GetCsvFileName (); // summary file name, without "-Summary.csv"
+  std::ofstream OpenSummaryFile (); // for the row of m_rngRun, with the header for the first run
+  static double GetStopMetric (const std::string &name, const RunSummary &srs);
+  bool IsPreciseEnough (); // standard error of all stop metrics is below the target
+  std::string GetTraceFileName (); // ns-2 mobility trace of the scenario, empty if mobility is not from a trace
+  static std::string FindTraceFile (std::string traceFile); // trace itself or its .gz or .zip archive
+  const MobilityTrace & GetMobilityTrace (std::string traceFile);
+
   uint64_t m_startRngRun; // first RngRun
   uint64_t m_stopRngRun; // last RngRun
   uint64_t m_rngRun; // current value for RngRun
   std::string m_csvFileNamePrefix; // file name for writing simulation summary results
+  std::string m_csvFileName; // prefix extended with the scenario description, set by Run
   double m_simDuration;
+  RunMetrics m_metrics; // resources used by the last run, set by Run
+  std::string m_benchmarkFile; // resources used by every run, see WriteBenchmark
+  bool m_externalRngRunControl = true; // one run per process, RngRun is given with --currentRngRun
+  uint32_t m_nWorkers = 0; // worker processes for internal rng run control, 0 = one per CPU core
+  std::string m_sweepFile; // parameter sweep specification, see vanet-npaf-sweep.h
+  std::string m_cacheDir = "vanet-npaf-cache"; // results of finished runs, see vanet-npaf-cache.h
+  std::string m_cacheVersion; // version of cached results, empty = version of this build
+  std::string m_progressDir = "/dev/shm/vanet-npaf-progress"; // live progress records, see vanet-npaf-progress.h
+  bool m_monitor = false; // this process only shows progress of other processes
+  bool m_warmupDetection = false; // applications start when steady state is detected, m_netStartupTime at the latest
+
+  // sequential stopping: runs stop before m_stopRngRun when results are precise enough
+  double m_targetRelStdErr = 0.0; // standard error relative to the average, 0 = all runs are simulated
+  uint64_t m_minRngRuns = 10; // runs simulated before precision is checked
+  std::string m_stopMetrics = "throughput,e2eDelayAverage"; // all packets averages checked for precision
+  std::vector<std::vector<double> > m_stopSamples; // values of stop metrics in written runs
+  uint64_t m_nResults = 0; // runs with results written to the summary file, failed runs are not counted
+
+  // simulation parameters, set by Configure
+  uint32_t m_nNodes = 100; // number of nodes
+  uint32_t m_nSources = 10; // number of source nodes for application traffic (number of sink nodes is the same in this example)
+
+  // SCENARIO
+  int m_scenario = 1; // MSBM
+  // Parameters for RW mobility model
+  double m_nodeSpeed = 15.0; // m/s
+  double m_nodePause = 0.0; // s
+  double m_simAreaX = 2000.0; // m
+  double m_simAreaY = 2000.0; // m
+  bool m_lazyMobility = false; // only the next course change of every node is scheduled (events at the same time may run in another order)
+  bool m_parkInactive = false; // vehicles before they enter the trace and after they leave the area are parked
+
+  double m_simulationTime = 500.0; // in seconds
+  double m_netStartupTime = 100.0; // [s] time before any application starts sending data
+
+  std::string m_rate = "4kbps"; // application layer data rate
+  std::string m_phyMode = "OfdmRate6MbpsBW10MHz"; // physical data rate and modulation type
+  uint32_t m_packetSize = 512; // Bytes
+
+  double m_txp = 20; // dBm, transmission power
+  double m_rxSensitivity = -101.0; // dBm, weaker signals are neither received nor tracked as interference
+  uint32_t m_lossModel = 3; ///< loss model [default: TwoRayGroundPropagationLossModel]
+  uint32_t m_fading = 0; // 0=None; 1=Nakagami; 2=Nakagami from tables
+  bool m_channelCutoff = false; // transmissions are not delivered beyond the range of sensitivity (off until compared with YansWifiChannel)
+  double m_lossTable = 0.0; // [m] step of path loss table, 0 = loss computed by the model
+  bool m_positionCache = false; // channel takes positions from arrays updated at course changes
+  uint32_t m_errorModel = 0; // 0=default of YansWifiPhyHelper; 1=tables made from it
+  bool m_sharedPpdu = false; // all receivers of a transmission get the same PPDU
+  bool m_allocStats = false; // heap allocations of every run are printed
+  bool m_allocPool = false; // small blocks freed during a run are reused instead of returned to malloc
+  uint32_t m_scheduler = 0; // 0=Map; 1=Heap; 2=Calendar; 3=TimingWheel (all give the same results)
+  bool m_profile = false; // count and time of events by type are written next to the summary file
+
+  uint32_t m_routingProtocol = 2; ///< routing protocol, AODV default
+  int m_routingTables = 0; ///< routing tables
+
+  bool m_verbose = false;
+
+  static std::map<std::string, MobilityTrace> m_mobilityTraces; // traces already read in this process, shared by all experiments
+  static ProgressReporter m_progress; // progress record of this process
 };
 
+std::map<std::string, MobilityTrace> RoutingExperiment::m_mobilityTraces;
+ProgressReporter RoutingExperiment::m_progress;
+
 RoutingExperiment::RoutingExperiment (uint64_t stopRun, std::string fn):
     m_startRngRun (1), 
     m_stopRngRun (stopRun),
@@ -84,25 +207,51 @@ RoutingExperiment::RoutingExperiment (uint64_t startRun, uint64_t stopRun, std::
 	NS_ASSERT_MSG (m_startRngRun <= m_stopRngRun, "First run number must be less or equal to last.");
 }
 
-void
-RoutingExperiment::WriteToSummaryFile (RunSummary srs)
+std::ofstream
+RoutingExperiment::OpenSummaryFile ()
 {
   std::ofstream out;
   if (m_rngRun == m_startRngRun)
     {
-      out.open ((m_csvFileNamePrefix + "-Summary.csv").c_str (), std::ofstream::out | std::ofstream::trunc);
+      out.open ((m_csvFileName + "-Summary.csv").c_str (), std::ofstream::out | std::ofstream::trunc);
       out << "Rng Run, Number of Flows, Throughput [bps],, Tx Packets,, Rx Packets,, Lost Packets,, Lost Ratio [%],, PHY Tx Packets,, Useful Traffic Ratio [%],,"
-          << "E2E Delay Min [ms],, E2E Delay Max [ms],, E2E Delay Average [ms],, E2E Delay Median Estimate [ms],, E2E Delay Jitter [ms],, Sim. Duration"
+          << "E2E Delay Min [ms],, E2E Delay Max [ms],, E2E Delay Average [ms],, E2E Delay Median Estimate [ms],, E2E Delay Jitter [ms],, Sim. Duration,,"
+          << " CPU Time [s], Setup [s], Event Loop [s], Events, Peak RSS [MB], Events per Sim. Second"
           << std::endl;
       out << ", , all flows avg, all packets avg, all flows avg, all packets avg, all flows avg, all packets avg, all flows avg, all packets avg, all flows avg, all packets avg"
           << "  , all flows avg, all packets avg, all flows avg, all packets avg, all flows avg, all packets avg, all flows avg, all packets avg, all flows avg, all packets avg"
           << "  , all flows avg, all packets avg, all packets avg, all packets avg, [min], [day hour min sec]"
+          << ", , wall clock, wall clock, , of the process, "
           << std::endl;
     }
   else
     {
-      out.open ((m_csvFileNamePrefix + "-Summary.csv").c_str (), std::ofstream::out | std::ofstream::app);
+      out.open ((m_csvFileName + "-Summary.csv").c_str (), std::ofstream::out | std::ofstream::app);
+    }
+  return out;
+}
+
+bool
+RoutingExperiment::WriteFailedRun (uint64_t run)
+{
+  // the row keeps its place, so footer formulas still cover rows of all runs; its empty cells are not
+  // counted by the formulas, the standard error is divided by the number of runs with results (COUNT)
+  m_rngRun = run;
+  std::ofstream out = OpenSummaryFile ();
+  out << m_rngRun << ",failed" << std::endl;
+  out.close ();
+  if (m_rngRun >= m_stopRngRun)
+    {
+      WriteSummaryFooter ();
+      return false;
     }
+  return true;
+}
+
+void
+RoutingExperiment::WriteToSummaryFile (RunSummary srs)
+{
+  std::ofstream out = OpenSummaryFile ();
   out << m_rngRun << "," << srs.numberOfFlows << ","
       << srs.aaf.throughput << "," << srs.aap.throughput << ","
       << srs.aaf.txPackets << "," << srs.aap.txPackets << ","
@@ -124,235 +273,654 @@ RoutingExperiment::WriteToSummaryFile (RunSummary srs)
   
   out << "," << m_simDuration / 60.0 << "," 
       << days << "d " << hours << "h " << min << "m " << sec << "s";
+  out << "," << m_metrics.cpuTime << "," << m_metrics.setupTime << "," << m_metrics.loopTime << ","
+      << m_metrics.events << "," << m_metrics.peakRssMb << ","
+      << (m_metrics.simTime > 0 ? m_metrics.events / m_metrics.simTime : 0.0);
   out << std::endl;
-  
+  out.close ();
+
   if (m_rngRun == m_stopRngRun)
     {
-      out << std::endl;
-      out << "," << "Min,"
-                    << "=MIN(C3:C" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(D3:D" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(E3:E" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(F3:F" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(G3:G" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(H3:H" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(I3:I" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(J3:J" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(K3:K" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(L3:L" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << ","
+      WriteSummaryFooter ();
+    }
+}
+
+void
+RoutingExperiment::WriteSummaryFooter ()
+{
+  // statistics of all runs from m_startRngRun to m_stopRngRun
+  std::ofstream out ((m_csvFileName + "-Summary.csv").c_str (), std::ofstream::out | std::ofstream::app);
+  out << std::endl;
+  out << "," << "Min,"
+                << "=MIN(C3:C" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(D3:D" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(E3:E" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(F3:F" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(G3:G" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(H3:H" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(I3:I" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(J3:J" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(K3:K" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(L3:L" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
 //                    << "=MIN(M3:M" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(N3:N" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << ","
+                << "=MIN(N3:N" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
 //                    << "=MIN(O3:O" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(P3:P" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(R3:R" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(S3:S" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(T3:T" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(U3:U" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(V3:V" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(W3:W" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(X3:X" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MIN(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << ")"
-                    << std::endl;
-      out << "," << "Max,"
-                    << "=MAX(C3:C" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(D3:D" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(E3:E" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(F3:F" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(G3:G" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(H3:H" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(I3:I" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(J3:J" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(K3:K" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(L3:L" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << ","
+                << "=MIN(P3:P" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(R3:R" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(S3:S" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(T3:T" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(U3:U" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(V3:V" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(W3:W" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(X3:X" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
+                << "=MIN(AC3:AC" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(AD3:AD" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(AE3:AE" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(AF3:AF" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(AG3:AG" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MIN(AH3:AH" << m_stopRngRun - m_startRngRun + 3 << ")"
+                << std::endl;
+  out << "," << "Max,"
+                << "=MAX(C3:C" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(D3:D" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(E3:E" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(F3:F" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(G3:G" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(H3:H" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(I3:I" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(J3:J" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(K3:K" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(L3:L" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
 //                    << "=MAX(M3:M" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(N3:N" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << ","
+                << "=MAX(N3:N" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
 //                    << "=MAX(O3:O" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(P3:P" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(R3:R" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(S3:S" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(T3:T" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(U3:U" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(V3:V" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(W3:W" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(X3:X" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MAX(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << ")"
-                    << std::endl;
-      out << "," << "Average,"
-                    << "=AVERAGE(C3:C" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(D3:D" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(E3:E" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(F3:F" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(G3:G" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(H3:H" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(I3:I" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(J3:J" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(K3:K" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(L3:L" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << ","
+                << "=MAX(P3:P" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(R3:R" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(S3:S" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(T3:T" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(U3:U" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(V3:V" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(W3:W" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(X3:X" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
+                << "=MAX(AC3:AC" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(AD3:AD" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(AE3:AE" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(AF3:AF" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(AG3:AG" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MAX(AH3:AH" << m_stopRngRun - m_startRngRun + 3 << ")"
+                << std::endl;
+  out << "," << "Average,"
+                << "=AVERAGE(C3:C" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(D3:D" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(E3:E" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(F3:F" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(G3:G" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(H3:H" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(I3:I" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(J3:J" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(K3:K" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(L3:L" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
 //                    << "=AVERAGE(M3:M" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(N3:N" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << ","
+                << "=AVERAGE(N3:N" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
 //                    << "=AVERAGE(O3:O" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(P3:P" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(R3:R" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(S3:S" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(T3:T" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(U3:U" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(V3:V" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(W3:W" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(X3:X" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=AVERAGE(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << ")"
-                    << std::endl;
-      out << "," << "Median,"
-                    << "=MEDIAN(C3:C" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(D3:D" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(E3:E" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(F3:F" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(G3:G" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(H3:H" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(I3:I" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(J3:J" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(K3:K" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(L3:L" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << ","
+                << "=AVERAGE(P3:P" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(R3:R" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(S3:S" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(T3:T" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(U3:U" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(V3:V" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(W3:W" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(X3:X" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
+                << "=AVERAGE(AC3:AC" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(AD3:AD" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(AE3:AE" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(AF3:AF" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(AG3:AG" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=AVERAGE(AH3:AH" << m_stopRngRun - m_startRngRun + 3 << ")"
+                << std::endl;
+  out << "," << "Median,"
+                << "=MEDIAN(C3:C" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(D3:D" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(E3:E" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(F3:F" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(G3:G" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(H3:H" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(I3:I" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(J3:J" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(K3:K" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(L3:L" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
 //                    << "=MEDIAN(M3:M" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(N3:N" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << ","
+                << "=MEDIAN(N3:N" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
 //                    << "=MEDIAN(O3:O" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(P3:P" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(R3:R" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(S3:S" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(T3:T" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(U3:U" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(V3:V" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(W3:W" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(X3:X" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << "),"
-                    << "=MEDIAN(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << ")"
-                    << std::endl;
-      out << "," << "Std. deviation,"
-                    << "=STDEV(C3:C" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(D3:D" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(E3:E" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(F3:F" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(G3:G" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(H3:H" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(I3:I" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(J3:J" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(K3:K" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(L3:L" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << ","
-//                    << "=STDEV(M3:M" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(N3:N" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << ","
-//                    << "=STDEV(O3:O" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(P3:P" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(R3:R" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(S3:S" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(T3:T" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(U3:U" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(V3:V" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(W3:W" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(X3:X" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << "),"
-                    << "=STDEV(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << ")/" << "SQRT(" << m_stopRngRun - m_startRngRun + 1 << ")"
-                    << std::endl;
-    }
+                << "=MEDIAN(P3:P" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(R3:R" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(S3:S" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(T3:T" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(U3:U" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(V3:V" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(W3:W" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(X3:X" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << ","
+                << "=MEDIAN(AC3:AC" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(AD3:AD" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(AE3:AE" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(AF3:AF" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(AG3:AG" << m_stopRngRun - m_startRngRun + 3 << "),"
+                << "=MEDIAN(AH3:AH" << m_stopRngRun - m_startRngRun + 3 << ")"
+                << std::endl;
+  out << "," << "Std. deviation,"
+                << "=STDEV(C3:C" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(C3:C" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(D3:D" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(D3:D" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(E3:E" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(E3:E" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(F3:F" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(F3:F" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(G3:G" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(G3:G" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(H3:H" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(H3:H" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(I3:I" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(I3:I" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(J3:J" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(J3:J" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(K3:K" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(K3:K" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(L3:L" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(L3:L" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << ","
+//                    << "=STDEV(M3:M" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(M3:M" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(N3:N" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(N3:N" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << ","
+//                    << "=STDEV(O3:O" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(O3:O" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(P3:P" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(P3:P" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(Q3:Q" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(R3:R" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(R3:R" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(S3:S" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(S3:S" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(T3:T" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(T3:T" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(U3:U" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(U3:U" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(V3:V" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(V3:V" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(W3:W" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(W3:W" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(X3:X" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(X3:X" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(Y3:Y" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(Z3:Z" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(AA3:AA" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << ","
+                << "=STDEV(AC3:AC" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(AC3:AC" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(AD3:AD" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(AD3:AD" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(AE3:AE" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(AE3:AE" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(AF3:AF" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(AF3:AF" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(AG3:AG" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(AG3:AG" << m_stopRngRun - m_startRngRun + 3 << ")),"
+                << "=STDEV(AH3:AH" << m_stopRngRun - m_startRngRun + 3 << ")/SQRT(COUNT(AH3:AH" << m_stopRngRun - m_startRngRun + 3 << "))"
+                << std::endl;
   out.close ();
-};
+}
 
-RunSummary
-RoutingExperiment::Run (int argc, char **argv)
+void
+RoutingExperiment::Configure (int argc, char **argv)
 {
-  //---------------------------------------------
-  // Initial configuration and attributes
-  //---------------------------------------------
-  uint32_t nNodes = 100; // number of nodes
-  uint32_t nSources = 10; // number of source nodes for application traffic (number of sink nodes is the same in this example)
+  CommandLine cmd;
+  cmd.AddValue ("csvFileNamePrefix", "The name prefix of the CSV output file (without .csv extension)", m_csvFileNamePrefix);
+  cmd.AddValue ("nNodes", "Number of nodes in simulation", m_nNodes);
+  cmd.AddValue ("nSources", "Number of nodes that send data (max = nNodes/2)", m_nSources);
+  cmd.AddValue ("simTime", "Duration of one simulation run.", m_simulationTime);
+  cmd.AddValue ("startupTime", "Network startup time before apps start sending packets.", m_netStartupTime);
+  cmd.AddValue ("warmupDetection", "Start apps as soon as routing traffic and node density are stable (MSER-5, from 30 s on); startupTime is then the maximum warm-up", m_warmupDetection);
 
-  // SCENARIO 
-  int scenario = 1; // MSBM
-  // Parameters for RW mobility model
-  double nodeSpeed = 15.0; // m/s
-  double nodePause = 0.0; // s
-  double simAreaX = 2000.0; // m
-  double simAreaY = 2000.0; // m
+  cmd.AddValue ("currentRngRun", "Current number of RngRun. Used only with --externalRngRunControl=1.", m_rngRun);
+  cmd.AddValue ("startRngRun", "Start number of RngRun. Used in both internal and external rng run generation.", m_startRngRun);
+  cmd.AddValue ("stopRngRun", "End number of RngRun (must be greater then or equal to startRngNum). Used in both internal and external rng run generation.", m_stopRngRun);
+  cmd.AddValue ("externalRngRunControl", "1=only RngRun given by --currentRngRun is simulated (runs are started by the script); 0=all runs from startRngRun to stopRngRun are simulated by this program", m_externalRngRunControl);
+  cmd.AddValue ("workers", "Number of worker processes used with --externalRngRunControl=0 (0 = one per CPU core, 1 = all runs in this process)", m_nWorkers);
+  cmd.AddValue ("targetRelStdErr", "Stop before stopRngRun when standard error of every stop metric is below this fraction of its average, e.g. 0.01 (0 = simulate all runs; not used with --externalRngRunControl=1)", m_targetRelStdErr);
+  cmd.AddValue ("minRngRuns", "Minimum number of runs before precision is checked (with --targetRelStdErr)", m_minRngRuns);
+  cmd.AddValue ("stopMetrics", "Comma separated all packets averages checked with --targetRelStdErr (throughput, lostRatio, e2eDelayAverage, ...)", m_stopMetrics);
+  cmd.AddValue ("cacheDir", "Directory with results of finished runs; runs found there are not simulated again (empty = no cache)", m_cacheDir);
+  cmd.AddValue ("cacheVersion", "Version of cached results (default is derived from this build, so rebuilt program simulates everything again)", m_cacheVersion);
+  cmd.AddValue ("progressDir", "Directory of live progress records of running processes (empty = no records)", m_progressDir);
+  cmd.AddValue ("monitor", "1=show progress of all runs of other processes (in progressDir) until they end, nothing is simulated", m_monitor);
+  cmd.AddValue ("benchmarkFile", "CSV file to which resources used by every run (wall, setup, event loop and CPU time, events, peak memory) are appended (empty = none)", m_benchmarkFile);
+  cmd.AddValue ("sweep", "Parameter sweep specification file; every point of the sweep is simulated for all RngRuns, other options are defaults for all points", m_sweepFile);
 
-  double simulationTime = 500.0; // in seconds
-  double netStartupTime = 100.0; // [s] time before any application starts sending data
+  cmd.AddValue ("dataRate", "Application data rate.", m_rate);
+  cmd.AddValue ("packetSize", "Application test packet size.", m_packetSize);
 
-  std::string rate ("4kbps"); // application layer data rate
-  std::string phyMode ("OfdmRate6MbpsBW10MHz"); // physical data rate and modulation type
-  uint32_t packetSize = 512; // Bytes
+  cmd.AddValue ("lossModel", "Propagation loss model: 1=Friis; 2=ItuR1411Los; 3=TwoRayGround; 4=LogDistance", m_lossModel);
+  cmd.AddValue ("fading", "0=None;1=Nakagami;2=Nakagami from tables (same distribution, faster);(buildings=1 overrides)", m_fading);
+  cmd.AddValue ("txp", "Transmission power.", m_txp);
+  cmd.AddValue ("rxSensitivity", "Weaker signals [dBm] are dropped by the channel, so they are neither received nor tracked as interference; higher = fewer interference events per PHY and shorter channel cutoff (default of ns-3 is -101)", m_rxSensitivity);
+  cmd.AddValue ("sharedPpdu", "1=all receivers get the same PPDU (only with channelCutoff=1); 0=copy for every receiver, as YansWifiChannel", m_sharedPpdu);
+  cmd.AddValue ("allocStats", "Print number of heap allocations of every run (only in vanet-npaf-alloc)", m_allocStats);
+  cmd.AddValue ("allocPool", "1=small blocks (packets, tags, events...) are reused from free lists, emptied after every run (only in vanet-npaf-alloc); 0=malloc", m_allocPool);
+  cmd.AddValue ("scheduler", "Event scheduler: 0=Map (default of ns-3); 1=Heap; 2=Calendar; 3=TimingWheel (same results, only speed differs)", m_scheduler);
+  cmd.AddValue ("profile", "1=count and wall clock time of executed events by type and subsystem of every run go to <summary file>-Run<RngRun>-Profile.csv", m_profile);
+  cmd.AddValue ("errorModel", "0=TableBasedErrorRateModel (default of YansWifiPhyHelper); 1=success rates interpolated from tables made from it at startup (faster)", m_errorModel);
+  cmd.AddValue ("channelCutoff", "1=transmissions are delivered only to nodes close enough to sense them and path loss is computed for all of them at once (without cutoff with fading); 0=YansWifiChannel", m_channelCutoff);
+  cmd.AddValue ("positionCache", "1=channel computes positions of all nodes once per timestamp from their current segments (faster, positions may differ in the last bits; only with channelCutoff=1); 0=from mobility models", m_positionCache);
+  cmd.AddValue ("lossTable", "Path loss is interpolated from a table with this step in metres (faster, slightly different results; only with channelCutoff=1); 0=computed by the model", m_lossTable);
 
-  double txp = 20; // dBm, transmission power
-  uint32_t lossModel = 3; ///< loss model [default: TwoRayGroundPropagationLossModel]
-  bool fading = 0; // 0=None; 1=Nakagami;
-  
-  uint32_t routingProtocol = 2; ///< routing protocol, AODV default
-  int routingTables = 0; ///< routing tables
+  cmd.AddValue ("scenario", "0=RW; 1=MSBM scenario; 2=MG-2x2mk-TrafficLight; 3=MG-2x2km-TrafficLight generated during simulation", m_scenario);
+  cmd.AddValue ("width", "Width of simulation area (X-axis).", m_simAreaX);
+  cmd.AddValue ("height", "Height of simulation area (Y-axis).", m_simAreaY);
+  cmd.AddValue ("nodeSpeed", "Max node speed.", m_nodeSpeed);
+  cmd.AddValue ("lazyMobility", "1=next course change of a node is scheduled when the previous one happens (events at the same time may run in another order, results can differ); 0=whole trace is scheduled at start", m_lazyMobility);
+  cmd.AddValue ("parkInactive", "1=vehicles before their first movement in the trace and after they leave the area are parked: PHY sleeps, so they cause no channel work, their timers keep running (scenarios 1 and 2); 0=all vehicles are active all the time", m_parkInactive);
+  cmd.AddValue ("routingTables", "Dump routing tables at t=5 seconds", m_routingTables);
+  cmd.AddValue ("routingProtocol", "Pouting protocol: 1=OLSR; 2=AODV; 3=DSDV; 4=DSR", m_routingProtocol);
+  cmd.AddValue ("verbose", "Turn on all WifiNetDevice log components", m_verbose);
+  cmd.Parse (argc, argv);
 
-  bool verbose = false;
+  NS_ASSERT_MSG (m_startRngRun <= m_stopRngRun, "First run number must be less or equal to last.");
+  m_csvFileName = GetCsvFileName ();
 
-  CommandLine cmd;
-  cmd.AddValue ("csvFileNamePrefix", "The name prefix of the CSV output file (without .csv extension)", m_csvFileNamePrefix);
-  cmd.AddValue ("nNodes", "Number of nodes in simulation", nNodes);
-  cmd.AddValue ("nSources", "Number of nodes that send data (max = nNodes/2)", nSources);
-  cmd.AddValue ("simTime", "Duration of one simulation run.", simulationTime);
-  cmd.AddValue ("startupTime", "Network startup time before apps start sending packets.", netStartupTime);
-
-  cmd.AddValue ("currentRngRun", "Current number of RngRun.", m_rngRun);
-  cmd.AddValue ("startRngRun", "Start number of RngRun. Used in external rng run generation.", m_startRngRun);
-  cmd.AddValue ("stopRngRun", "End number of RngRun (must be greater then or equal to startRngNum). Used in external rng run generation.", m_stopRngRun);
-
-  cmd.AddValue ("dataRate", "Application data rate.", rate);
-  cmd.AddValue ("packetSize", "Application test packet size.", packetSize);
-
-  cmd.AddValue ("lossModel", "Propagation loss model: 1=Friis; 2=ItuR1411Los; 3=TwoRayGround; 4=LogDistance", lossModel);
-  cmd.AddValue ("fading", "0=None;1=Nakagami;(buildings=1 overrides)", fading);
-  cmd.AddValue ("txp", "Transmission power.", txp);
-
-  cmd.AddValue ("scenario", "0=RW; 1=MSBM scenario; 2=MG-2x2mk-TrafficLight", scenario);
-  cmd.AddValue ("width", "Width of simulation area (X-axis).", simAreaX);
-  cmd.AddValue ("height", "Height of simulation area (Y-axis).", simAreaY);
-  cmd.AddValue ("nodeSpeed", "Max node speed.", nodeSpeed);
-  cmd.AddValue ("routingTables", "Dump routing tables at t=5 seconds", routingTables);
-  cmd.AddValue ("routingProtocol", "Pouting protocol: 1=OLSR; 2=AODV; 3=DSDV; 4=DSR", routingProtocol);
-  cmd.AddValue ("verbose", "Turn on all WifiNetDevice log components", verbose);
-  cmd.Parse (argc, argv);
+  std::istringstream metrics (m_stopMetrics);
+  std::string metric;
+  while (std::getline (metrics, metric, ','))
+    {
+      GetStopMetric (metric, RunSummary ()); // aborts on unknown name
+    }
+  m_stopSamples.clear ();
+  m_nResults = 0;
+}
+
+void
+RoutingExperiment::Configure (const std::vector<std::string> &args)
+{
+  std::vector<std::string> copy (args);
+  std::vector<char *> argv;
+  for (std::vector<std::string>::iterator a = copy.begin (); a != copy.end (); ++a)
+    {
+      argv.push_back (&(*a)[0]);
+    }
+  argv.push_back (NULL);
+  Configure (copy.size (), argv.data ());
+}
+
+std::string
+RoutingExperiment::GetParameters ()
+{
+  // every parameter used by Run, in fixed order and with full precision
+  std::ostringstream ss;
+  ss << std::setprecision (17)
+     << "nNodes=" << m_nNodes << " nSources=" << m_nSources << " scenario=" << m_scenario
+     << " nodeSpeed=" << m_nodeSpeed << " lazyMobility=" << m_lazyMobility << " parkInactive=" << m_parkInactive << " nodePause=" << m_nodePause << " width=" << m_simAreaX << " height=" << m_simAreaY
+     << " simTime=" << m_simulationTime << " startupTime=" << m_netStartupTime << " warmupDetection=" << m_warmupDetection
+     << " dataRate=" << m_rate << " phyMode=" << m_phyMode << " packetSize=" << m_packetSize
+     << " txp=" << m_txp << " rxSensitivity=" << m_rxSensitivity << " lossModel=" << m_lossModel << " fading=" << m_fading << " lossTable=" << m_lossTable << " positionCache=" << m_positionCache << " errorModel=" << m_errorModel
+     << " channelCutoff=" << m_channelCutoff << " sharedPpdu=" << m_sharedPpdu
+     << " routingProtocol=" << m_routingProtocol;
+  // a regenerated trace (same name, other contents) gives other results
+  std::string traceFile = GetTraceFileName ();
+  if (!traceFile.empty ())
+    {
+      ss << " trace=" << ResultCache::GetFileVersion (FindTraceFile (traceFile));
+    }
+  return ss.str ();
+}
+
+double
+RoutingExperiment::GetCostEstimate ()
+{
+  // every transmission is delivered to the nodes within the channel cutoff, and their
+  // number grows with node density in the fixed area (with channelCutoff=0 to all other
+  // nodes), so the number of events grows with the square of the number of nodes and
+  // linearly with simulated time
+  return (double) m_nNodes * m_nNodes * (m_netStartupTime + m_simulationTime);
+}
+
+std::string
+RoutingExperiment::GetCsvFileName ()
+{
+  // File name describes scenario, so that every configuration writes its own summary file
+  std::string sc; // scenario
+  switch (m_scenario)
+    {
+    case 0:
+      sc = "RW";
+      break;
+    case 1:
+      sc = "MG_2x2km_semafor_new";
+      break;
+    case 2:
+      sc = "MG_2x2km_semafor";
+      break;
+    case 3:
+      sc = "MG_2x2km_semafor_gen";
+      break;
+    }
+  std::string lm; // loss model
+  switch (m_lossModel)
+    {
+    case 1:
+      lm = "Fri";
+      break;
+    case 2:
+      lm = "ITUR1411";
+      break;
+    case 3:
+      lm = "TRG";
+      break;
+    case 4:
+      lm = "Log";
+      break;
+    }
+  if (m_fading != 0)
+    {
+      lm += m_fading == 2 ? "_NakTab" : "_Nak";
+    }
+  std::string rp; // routing protocol
+  switch (m_routingProtocol)
+    {
+    case 0:
+      rp = "NONE";
+      break;
+    case 1:
+      rp = "OLSR";
+      break;
+    case 2:
+      rp = "AODV";
+      break;
+    case 3:
+      rp = "DSDV";
+      break;
+    case 4:
+      rp = "DSR";
+      break;
+    }
+  std::string tp = "UDP"; // transport protocol
+  return m_csvFileNamePrefix + "-Sc_" + sc + "-Loss_" + lm + "-Rout_" + rp + "-Tr_" + tp + "-" + std::to_string (m_nSources) + "of" + std::to_string (m_nNodes)
+         + "-" + m_rate + "-" + std::to_string (m_packetSize) + "B";
+}
+
+std::string
+RoutingExperiment::GetTraceFileName ()
+{
+  std::string traceFile;
+  switch (m_scenario)
+    {
+    case 1:
+      {
+        // one SUMO trace for every density, e.g. scratch/ns2Trace-050.txt
+        std::ostringstream ss;
+        ss << "scratch/ns2Trace-" << std::setw (3) << std::setfill ('0') << m_nNodes << ".txt";
+        traceFile = ss.str ();
+        break;
+      }
+    case 2:
+      //traceFile = std::string("scratch/mg-telfor-15mps-semafor-") + std::to_string(m_nNodes) + std::string("-fcd.txt");
+      traceFile = std::string("scratch/mg-telfor-15mps-semafor-350-fcd.txt");
+      break;
+    }
+  return traceFile;
+}
+
+std::string
+RoutingExperiment::FindTraceFile (std::string traceFile)
+{
+  // traces can stay compressed, e.g. scratch/ns2Trace-050.txt.zip
+  const char *suffixes[] = { "", ".gz", ".zip" };
+  for (const char *suffix : suffixes)
+    {
+      struct stat st;
+      if (stat ((traceFile + suffix).c_str (), &st) == 0)
+        {
+          return traceFile + suffix;
+        }
+    }
+  return traceFile;
+}
+
+void
+RoutingExperiment::PrepareMobilityTrace ()
+{
+  // binary copy of the trace is made if it does not exist or is older than the trace
+  std::string traceFile = GetTraceFileName ();
+  if (traceFile.empty ())
+    {
+      return;
+    }
+  std::string binFile = traceFile + ".bin";
+  std::string sourceFile = FindTraceFile (traceFile);
+  struct stat text, bin;
+  NS_ABORT_MSG_UNLESS (stat (sourceFile.c_str (), &text) == 0, "Can not read mobility trace " << traceFile);
+  MobilityTrace trace;
+  if (stat (binFile.c_str (), &bin) == 0 && bin.st_mtime >= text.st_mtime && trace.LoadBinary (binFile))
+    {
+      return;
+    }
+  NS_ABORT_MSG_UNLESS (trace.LoadNs2 (sourceFile), "Can not read mobility trace " << sourceFile);
+  if (!trace.SaveBinary (binFile))
+    {
+      NS_LOG_UNCOND ("Can not write binary mobility trace " << binFile);
+    }
+}
+
+const MobilityTrace &
+RoutingExperiment::GetMobilityTrace (std::string traceFile)
+{
+  // trace is read only in the first run, other runs in this process reuse it
+  std::map<std::string, MobilityTrace>::iterator it = m_mobilityTraces.find (traceFile);
+  if (it == m_mobilityTraces.end ())
+    {
+      it = m_mobilityTraces.insert (std::make_pair (traceFile, MobilityTrace ())).first;
+      // binary copy made by PrepareMobilityTrace is mapped into memory, text trace is parsed only without it
+      std::string binFile = traceFile + ".bin";
+      std::string sourceFile = FindTraceFile (traceFile);
+      struct stat text, bin;
+      bool fresh = stat (binFile.c_str (), &bin) == 0 && (stat (sourceFile.c_str (), &text) != 0 || bin.st_mtime >= text.st_mtime);
+      if (!fresh || !it->second.LoadBinary (binFile))
+        {
+          bool ok = it->second.LoadNs2 (sourceFile);
+          NS_ABORT_MSG_UNLESS (ok, "Can not read mobility trace " << sourceFile);
+        }
+    }
+  return it->second;
+}
+
+RunResult
+RoutingExperiment::Simulate (uint64_t run)
+{
+  RunResult r;
+  r.rngRun = run;
+  m_rngRun = run;
+  auto start = std::chrono::system_clock::now();
+  r.srs = Run ();
+  auto end = std::chrono::system_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end-start;
+  r.simDuration = elapsed_seconds.count();
+  r.metrics = m_metrics;
+  return r;
+}
+
+bool
+RoutingExperiment::WriteResult (const RunResult &r)
+{
+  m_rngRun = r.rngRun;
+  m_simDuration = r.simDuration;
+  m_metrics = r.metrics;
+  WriteToSummaryFile (r.srs); // -> file: <m_csvFileNamePrefix>-Summary.csv
+  m_nResults++;
+  if (!m_benchmarkFile.empty ())
+    {
+      WriteBenchmark (r);
+    }
+  if (m_rngRun >= m_stopRngRun)
+    {
+      return false;
+    }
+
+  if (m_targetRelStdErr <= 0.0)
+    {
+      return true;
+    }
+  std::istringstream metrics (m_stopMetrics);
+  std::string metric;
+  for (uint32_t i = 0; std::getline (metrics, metric, ','); i++)
+    {
+      if (i >= m_stopSamples.size ())
+        {
+          m_stopSamples.resize (i + 1);
+        }
+      m_stopSamples[i].push_back (GetStopMetric (metric, r.srs));
+    }
+  if (IsPreciseEnough ())
+    {
+      // this run is the last one, footer formulas cover only written runs
+      NS_LOG_UNCOND (m_csvFileName << ": target precision reached after " << m_nResults << " runs");
+      m_stopRngRun = m_rngRun;
+      WriteSummaryFooter ();
+      return false;
+    }
+  return true;
+}
+
+void
+RoutingExperiment::WriteBenchmark (const RunResult &r)
+{
+  // one file for all experiments and runs, the header is written only to a new file
+  bool empty = std::ifstream (m_benchmarkFile.c_str ()).peek () == std::ifstream::traits_type::eof ();
+  std::ofstream out (m_benchmarkFile.c_str (), std::ofstream::out | std::ofstream::app);
+  if (empty)
+    {
+      out << "Name,Scenario,Routing Protocol,Nodes,Rng Run,Sim. Time [s],Wall Time [s],Setup [s],Event Loop [s],CPU Time [s],"
+          << "Events,Events/s,Peak RSS [MB],Sim. s/s" << std::endl;
+    }
+  const RunMetrics &m = r.metrics;
+  out << m_csvFileName << "," << m_scenario << "," << m_routingProtocol << "," << m_nNodes << "," << r.rngRun << ","
+      << m.simTime << "," << r.simDuration << "," << m.setupTime << "," << m.loopTime << "," << m.cpuTime << ","
+      << m.events << "," << (m.loopTime > 0 ? m.events / m.loopTime : 0.0) << "," << m.peakRssMb << ","
+      << (r.simDuration > 0 ? m.simTime / r.simDuration : 0.0) << std::endl;
+}
+
+double
+RoutingExperiment::GetStopMetric (const std::string &name, const RunSummary &srs)
+{
+  if (name == "throughput")
+    return srs.aap.throughput;
+  if (name == "txPackets")
+    return srs.aap.txPackets;
+  if (name == "rxPackets")
+    return srs.aap.rxPackets;
+  if (name == "lostPackets")
+    return srs.aap.lostPackets;
+  if (name == "lostRatio")
+    return srs.aap.lostRatio;
+  if (name == "phyTxPkts")
+    return srs.aap.phyTxPkts;
+  if (name == "usefullNetTraffic")
+    return srs.aap.usefullNetTraffic;
+  if (name == "e2eDelayMin")
+    return srs.aap.e2eDelayMin;
+  if (name == "e2eDelayMax")
+    return srs.aap.e2eDelayMax;
+  if (name == "e2eDelayAverage")
+    return srs.aap.e2eDelayAverage;
+  if (name == "e2eDelayMedianEstimate")
+    return srs.aap.e2eDelayMedianEstimate;
+  if (name == "e2eDelayJitter")
+    return srs.aap.e2eDelayJitter;
+  NS_FATAL_ERROR ("Unknown stop metric: " << name);
+  return 0.0;
+}
+
+bool
+RoutingExperiment::IsPreciseEnough ()
+{
+  // same standard error as the "Std. deviation" row of the summary file: STDEV/SQRT(n), n = runs with results
+  if (m_nResults < m_minRngRuns)
+    {
+      return false;
+    }
+  for (std::vector<std::vector<double> >::const_iterator x = m_stopSamples.begin (); x != m_stopSamples.end (); ++x)
+    {
+      uint64_t n = x->size ();
+      if (n < 2)
+        {
+          return false;
+        }
+      double sum = 0.0;
+      for (std::vector<double>::const_iterator v = x->begin (); v != x->end (); ++v)
+        {
+          sum += *v;
+        }
+      double mean = sum / n;
+      double ss = 0.0;
+      for (std::vector<double>::const_iterator v = x->begin (); v != x->end (); ++v)
+        {
+          ss += (*v - mean) * (*v - mean);
+        }
+      double stdErr = std::sqrt (ss / (n - 1)) / std::sqrt ((double) n);
+      if (stdErr > m_targetRelStdErr * std::fabs (mean))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+RunSummary
+RoutingExperiment::Run ()
+{
+  //---------------------------------------------
+  // Initial configuration and attributes
+  //---------------------------------------------
+  // Simulation parameters are members set by Configure ()
+  NS_ABORT_MSG_IF ((m_allocStats || m_allocPool) && !AllocationStats::HOOKED,
+                   "allocStats and allocPool need the allocation hook, run vanet-npaf-alloc instead of vanet-npaf");
+  AllocationStats allocStart = AllocationStats::Get ();
+  AllocationPool::Enable (m_allocPool);
+  std::chrono::steady_clock::time_point setupStart = std::chrono::steady_clock::now ();
+  double cpuStart = ResourceUsage::GetCpuTime ();
+  ResourceUsage::ResetPeakRss ();
 
-  // Should be placed after cmd.Parse () because user can overload rng run number with command line option "--currentRngRun"
+  // Every run has a new simulator, made with the scheduler set here
+  const char *schedulers[] = { "ns3::MapScheduler", "ns3::HeapScheduler", "ns3::CalendarScheduler", "ns3::TimingWheelScheduler" };
+  NS_ABORT_MSG_IF (m_scheduler >= sizeof (schedulers) / sizeof (schedulers[0]), "Unknown scheduler " << m_scheduler);
+  ObjectFactory scheduler (schedulers[m_scheduler]);
+  if (!m_progressDir.empty () || m_profile)
+    {
+      // the same scheduler, which also counts events in the queue for the progress record and profiles events
+      scheduler.SetTypeId ("ns3::ObservedScheduler");
+      scheduler.Set ("Scheduler", StringValue (schedulers[m_scheduler]));
+      scheduler.Set ("Profile", BooleanValue (m_profile));
+    }
+  Simulator::SetScheduler (scheduler);
+
+  // Should be placed after Configure () because user can overload rng run number with command line option "--currentRngRun"
   RngSeedManager::SetRun (m_rngRun);
+  // Every run starts from the same stream numbers, as if it was the only run in the process
+  RngSeedManager::ResetNextStreamIndex ();
 
   // Disable fragmentation for frames below 2200 bytes
   Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("2200"));
   // Turn off RTS/CTS for frames below 2200 bytes
   Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("2200"));
   //Set Non-unicastMode rate to unicast mode
-  Config::SetDefault ("ns3::WifiRemoteStationManager::NonUnicastMode",StringValue (phyMode));
+  Config::SetDefault ("ns3::WifiRemoteStationManager::NonUnicastMode",StringValue (m_phyMode));
 
   //---------------------------------------------
   // Creating vehicle nodes
   //---------------------------------------------
   NodeContainer vehicles;
-  vehicles.Create (nNodes);
+  vehicles.Create (m_nNodes);
 
   //---------------------------------------------
   // Channel configuration
@@ -361,32 +929,27 @@ RoutingExperiment::Run (int argc, char **argv)
   wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
   
   std::string lossModelName;
-  std::string lm;
   double freq = 5.9e9; // 802.11p 5.9 GHz
-  if (lossModel == 1)
+  if (m_lossModel == 1)
     {
       lossModelName = "ns3::FriisPropagationLossModel";
       wifiChannel.AddPropagationLoss (lossModelName, "Frequency", DoubleValue (freq));
-      lm = "Fri";
     }
-  else if (lossModel == 2)
+  else if (m_lossModel == 2)
     {
       lossModelName = "ns3::ItuR1411LosPropagationLossModel";
       wifiChannel.AddPropagationLoss (lossModelName, "Frequency", DoubleValue (freq));
-      lm = "ITUR1411";
     }
-  else if (lossModel == 3)
+  else if (m_lossModel == 3)
     {
       lossModelName = "ns3::TwoRayGroundPropagationLossModel";
-      lm = "TRG";
       // two-ray requires antenna height (else defaults to Friss)
       wifiChannel.AddPropagationLoss (lossModelName, "Frequency", DoubleValue (freq), "HeightAboveZ", DoubleValue (1.5));
     }
-  else if (lossModel == 4)
+  else if (m_lossModel == 4)
     {
       lossModelName = "ns3::LogDistancePropagationLossModel";
       wifiChannel.AddPropagationLoss (lossModelName, "Frequency", DoubleValue (freq));
-      lm = "Log";
     }
   else
     {
@@ -394,55 +957,69 @@ RoutingExperiment::Run (int argc, char **argv)
       NS_LOG_ERROR ("Invalid propagation loss model specified.  Values must be [1-4], where 1=Friis;2=ItuR1411Los;3=TwoRayGround;4=LogDistance");
     }
   // Propagation loss models are additive, so we can add Nakagami feding
-  if (fading != 0)
+  if (m_fading != 0)
     {
       // if no obstacle model, then use Nakagami fading if requested
-      wifiChannel.AddPropagationLoss ("ns3::NakagamiPropagationLossModel");
-      lm += "_Nak";
+      // fast model draws one uniform variate from its own stream per packet and receiver
+      wifiChannel.AddPropagationLoss (m_fading == 2 ? "ns3::FastNakagamiPropagationLossModel" : "ns3::NakagamiPropagationLossModel");
     }
   // create the channel
   Ptr<YansWifiChannel> channel = wifiChannel.Create ();
+  if (m_channelCutoff)
+    {
+      Ptr<CutoffWifiChannel> fastChannel = CutoffWifiChannel::CreateFrom (channel);
+      fastChannel->SetCutoff (!m_fading); // skipped receivers would not draw their fading
+      fastChannel->SetSharedPpdu (m_sharedPpdu);
+      fastChannel->SetPositionCache (m_positionCache);
+      fastChannel->SetLossTable (m_lossTable, std::sqrt (m_simAreaX * m_simAreaX + m_simAreaY * m_simAreaY) + 100.0);
+      channel = fastChannel;
+    }
 
   //---------------------------------------------
   // NIC: PHY + MAC configuration 
   //---------------------------------------------
   // Set the wifi NICs we want
-  YansWifiPhyHelper wifiPhy;
+  // PHYs send through CutoffWifiChannel::Send, on YansWifiChannel they are YansWifiPhy
+  CutoffWifiPhyHelper wifiPhy;
   wifiPhy.SetChannel (channel);
   // ns-3 supports generate a pcap trace
   wifiPhy.SetPcapDataLinkType (WifiPhyHelper::DLT_IEEE802_11);
 
   // Set Tx Power
-  wifiPhy.Set ("TxPowerStart",DoubleValue (txp));
-  wifiPhy.Set ("TxPowerEnd", DoubleValue (txp));
+  wifiPhy.Set ("TxPowerStart",DoubleValue (m_txp));
+  wifiPhy.Set ("TxPowerEnd", DoubleValue (m_txp));
+  wifiPhy.Set ("RxSensitivity", DoubleValue (m_rxSensitivity));
+  if (m_errorModel == 1)
+    {
+      // tables are checked against the reference for chunks of the application packet size
+      wifiPhy.SetErrorRateModel ("ns3::TabulatedErrorRateModel", "CheckBits", UintegerValue (8 * m_packetSize));
+    }
 
   // Add a mac and disable rate control
   NqosWaveMacHelper wifi80211pMac = NqosWaveMacHelper::Default ();
   Wifi80211pHelper wifi80211p = Wifi80211pHelper::Default ();
-  if (verbose)
+  if (m_verbose)
     {
       wifi80211p.EnableLogComponents ();      // Turn on all Wifi 802.11p logging
     }
   wifi80211p.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
-                                      "DataMode",StringValue (phyMode),
-                                      "ControlMode",StringValue (phyMode));
+                                      "DataMode",StringValue (m_phyMode),
+                                      "ControlMode",StringValue (m_phyMode));
   NetDeviceContainer devices = wifi80211p.Install (wifiPhy, wifi80211pMac, vehicles);
 
   //---------------------------------------------
   // Mobility configuration
   //---------------------------------------------
-  std::string sc;
-  switch (scenario){
+  switch (m_scenario){
   case 0:
   {
-    sc = "RW";
     MobilityHelper vehicleMobility;
     //int64_t streamIndex = 0; // used to get consistent mobility across scenarios
 
     std::stringstream ssX;
-    ssX << "ns3::UniformRandomVariable[Min=0.0|Max=" << simAreaX << "]";
+    ssX << "ns3::UniformRandomVariable[Min=0.0|Max=" << m_simAreaX << "]";
     std::stringstream ssY;
-    ssY << "ns3::UniformRandomVariable[Min=0.0|Max=" << simAreaY << "]";
+    ssY << "ns3::UniformRandomVariable[Min=0.0|Max=" << m_simAreaY << "]";
     ObjectFactory pos;
     pos.SetTypeId ("ns3::RandomRectanglePositionAllocator");
     pos.Set ("X", StringValue (ssX.str ()));
@@ -452,11 +1029,11 @@ RoutingExperiment::Run (int argc, char **argv)
     //streamIndex += taPositionAlloc->AssignStreams (streamIndex);
 
     std::stringstream ssSpeed;
-    //ssSpeed << "ns3::UniformRandomVariable[Min=0.0|Max=" << nodeSpeed << "]";
-    //ssSpeed << "ns3::UniformRandomVariable[Min=" << 0.9*nodeSpeed << "|Max=" << 1.1*nodeSpeed << "]";
-    ssSpeed << "ns3::NormalRandomVariable[Mean=" << nodeSpeed << "|Variance=" << (nodeSpeed/20)*(nodeSpeed/20) << "]";
+    //ssSpeed << "ns3::UniformRandomVariable[Min=0.0|Max=" << m_nodeSpeed << "]";
+    //ssSpeed << "ns3::UniformRandomVariable[Min=" << 0.9*m_nodeSpeed << "|Max=" << 1.1*m_nodeSpeed << "]";
+    ssSpeed << "ns3::NormalRandomVariable[Mean=" << m_nodeSpeed << "|Variance=" << (m_nodeSpeed/20)*(m_nodeSpeed/20) << "]";
     std::stringstream ssPause;
-    ssPause << "ns3::ConstantRandomVariable[Constant=" << nodePause << "]";
+    ssPause << "ns3::ConstantRandomVariable[Constant=" << m_nodePause << "]";
     vehicleMobility.SetMobilityModel ("ns3::RandomWaypointMobilityModel",
                                     "Speed", StringValue (ssSpeed.str ()),
                                     "Pause", StringValue (ssPause.str ()),
@@ -468,105 +1045,38 @@ RoutingExperiment::Run (int argc, char **argv)
     break;
   }
   case 1:
+  case 2:
   {
-    sc = "MG_2x2km_semafor_new";
-    std::string traceFile;
-    switch (nNodes)
-    {
-    case 50:
-      {
-        traceFile = std::string("scratch/ns2Trace-050.txt");
-        break;
-      }
-    case 100:
-      {
-        traceFile = std::string("scratch/ns2Trace-100.txt");
-        break;
-      }
-    case 150:
-      {
-        traceFile = std::string("scratch/ns2Trace-150.txt");
-        break;
-      }
-    case 200:
-      {
-        traceFile = std::string("scratch/ns2Trace-200.txt");
-        break;
-      }
-    case 250:
-      {
-        traceFile = std::string("scratch/ns2Trace-250.txt");
-        break;
-      }
-    case 300:
-      {
-        traceFile = std::string("scratch/ns2Trace-300.txt");
-        break;
-      }
-    case 350:
-      {
-        traceFile = std::string("scratch/ns2Trace-350.txt");
-        break;
-      }
-    case 400:
-      {
-        traceFile = std::string("scratch/ns2Trace-400.txt");
-        break;
-      }
-    case 450:
-      {
-        traceFile = std::string("scratch/ns2Trace-450.txt");
-        break;
-      }
-    case 500:
-      {
-        traceFile = std::string("scratch/ns2Trace-500.txt");
-        break;
-      }
-    case 550:
-      {
-        traceFile = std::string("scratch/ns2Trace-550.txt");
-        break;
-      }
-    case 600:
-      {
-        traceFile = std::string("scratch/ns2Trace-600.txt");
-        break;
-      }
-    case 650:
-      {
-        traceFile = std::string("scratch/ns2Trace-650.txt");
-        break;
-      }
-    case 700:
-      {
-        traceFile = std::string("scratch/ns2Trace-700.txt");
-        break;
-      }
-    default:
-      NS_ASSERT_MSG (0, "Number of vehicles not supported.");
-    }
-    Ns2MobilityHelper ns2 = Ns2MobilityHelper (traceFile);
-    ns2.Install ();
+    // configure movements for each node, trace is read only once
+    GetMobilityTrace (GetTraceFileName ()).Install (vehicles, m_lazyMobility);
     break;
   }
-  case 2:
+  case 3:
   {
-	  sc = "MG_2x2km_semafor";
-    //std::string traceFile = std::string("scratch/mg-telfor-15mps-semafor-") + std::to_string(nNodes) + std::string("-fcd.txt");
-    std::string traceFile = std::string("scratch/mg-telfor-15mps-semafor-350-fcd.txt");
-	  Ns2MobilityHelper ns2 = Ns2MobilityHelper (traceFile);
-
-	  // configure movements for each node, while reading
-	  ns2.Install ();
-	  break;
+    // the same grid as the traces (21x21 streets, 2 lanes, 9 traffic lights), any number of vehicles
+    ObjectFactory grid;
+    grid.SetTypeId ("ns3::ManhattanGridMobilityModel");
+    grid.Set ("Spacing", DoubleValue (m_simAreaX / 20));
+    std::stringstream ssSpeed;
+    ssSpeed << "ns3::NormalRandomVariable[Mean=" << m_nodeSpeed << "|Variance=" << (m_nodeSpeed/10)*(m_nodeSpeed/10) << "|Bound=" << m_nodeSpeed/4 << "]";
+    grid.Set ("Speed", StringValue (ssSpeed.str ()));
+    // fixed streams, so that vehicles move the same whatever else is in the simulation;
+    // RngRun selects the substream, i.e. different movement in every run
+    int64_t streamIndex = 1000000;
+    for (NodeContainer::Iterator n = vehicles.Begin (); n != vehicles.End (); ++n)
+      {
+        Ptr<MobilityModel> model = grid.Create<MobilityModel> ();
+        (*n)->AggregateObject (model);
+        streamIndex += model->AssignStreams (streamIndex);
+      }
+    break;
   }
   default:
 	  NS_LOG_UNCOND ("Scenario not supported");
 	  NS_ASSERT (0);
   }
 
-  if (verbose){
+  if (m_verbose){
 	  for (NodeContainer::Iterator j = vehicles.Begin (); j != vehicles.End (); ++j)
 		{
 		  Ptr<Node> object = *j;
@@ -592,38 +1102,33 @@ RoutingExperiment::Run (int argc, char **argv)
   Time rtt = Time (5.0);
   AsciiTraceHelper ascii;
   Ptr<OutputStreamWrapper> rtw = ascii.CreateFileStream ("routing_table");
-  std::string rp; ///< protocol name
-  switch (routingProtocol)
+  switch (m_routingProtocol)
     {
     case 0:
-      rp = "NONE";
       break;
     case 1:
-      if (routingTables != 0)
+      if (m_routingTables != 0)
         olsr.PrintRoutingTableAllAt (rtt, rtw);
       list.Add (olsr, 100);
-      rp = "OLSR";
       break;
     case 2:
-      if (routingTables != 0)
+      if (m_routingTables != 0)
         aodv.PrintRoutingTableAllAt (rtt, rtw);
       list.Add (aodv, 100);
-      rp = "AODV";
       break;
     case 3:
-      if (routingTables != 0) 
+      if (m_routingTables != 0) 
         dsdv.PrintRoutingTableAllAt (rtt, rtw);
       list.Add (dsdv, 100);
-      rp = "DSDV";
       break;
     case 4:
-      rp = "DSR";
+      // setup is later
       break;
     default:
-      NS_FATAL_ERROR ("No such protocol:" << routingProtocol);
+      NS_FATAL_ERROR ("No such protocol:" << m_routingProtocol);
       break;
     }
-  if (routingProtocol == 4)
+  if (m_routingProtocol == 4)
     {
       internet.Install (vehicles);
       dsrMain.Install (dsr, vehicles);
@@ -640,21 +1145,58 @@ RoutingExperiment::Run (int argc, char **argv)
   Ipv4InterfaceContainer adhocInterfaces;
   adhocInterfaces = addressAdhoc.Assign (devices);
 
+  // Vehicles are parked before they enter the trace and after they leave the area, after initialization of their protocols at time 0
+  if (m_parkInactive && (m_scenario == 1 || m_scenario == 2))
+    {
+      const MobilityTrace &trace = GetMobilityTrace (GetTraceFileName ());
+      uint32_t late = 0;
+      uint32_t early = 0;
+      for (uint32_t i = 0; i < vehicles.GetN (); i++)
+        {
+          double enter = 0.0;
+          double leave = std::numeric_limits<double>::infinity ();
+          if (!trace.GetActivity (i, m_simAreaX, m_simAreaY, enter, leave))
+            {
+              enter = leave; // never active
+            }
+          if (enter > 0.0 || enter >= leave)
+            {
+              Simulator::Schedule (Seconds (0), &SetVehicleActive, devices.Get (i), false);
+              late++;
+            }
+          if (enter > 0.0 && enter < leave)
+            {
+              Simulator::Schedule (Seconds (enter), &SetVehicleActive, devices.Get (i), true);
+            }
+          if (enter < leave && !std::isinf (leave))
+            {
+              Simulator::Schedule (Seconds (leave), &SetVehicleActive, devices.Get (i), false);
+              early++;
+            }
+        }
+      NS_LOG_UNCOND ("Parked vehicles: " << late << " before they enter the trace, " << early << " after they leave it");
+    }
+
   //---------------------------------------------
   // Applications configuration
   //---------------------------------------------
-  std::string tp = "UDP";
   std::string transportProtocolFactory = "ns3::UdpSocketFactory"; // protocol for transport layer
   Ptr<UniformRandomVariable> x = CreateObject<UniformRandomVariable> ();
   x->SetAttribute ("Min", DoubleValue (0));
-  x->SetAttribute ("Max", DoubleValue (nNodes-1));
+  x->SetAttribute ("Max", DoubleValue (m_nNodes-1));
   std::vector<int> ss; // sources and sinks
   uint32_t port = 80;
   int p, q;
   Ptr<UniformRandomVariable> var = CreateObject<UniformRandomVariable> ();
-  for (uint32_t i = 0; i<nSources; i++)
+  struct AppFlow
+  {
+    int source;
+    int sink;
+    double jitter;
+  };
+  std::vector<AppFlow> flows; // chosen here, so that warm-up detection does not change random numbers
+  for (uint32_t i = 0; i<m_nSources; i++)
     {
-      std::ostringstream oss;
       while (1) // choose random source that is unique (node that is not used before as source or sink)
         {
           p = (int) x->GetInteger ();
@@ -671,25 +1213,37 @@ RoutingExperiment::Run (int argc, char **argv)
           if (it == ss.end())
             { ss.push_back(q); NS_LOG_UNCOND(p << " -> " << q); break; }
         }
-      oss <<  "10.1.0." << q+1; //destination address
-      InetSocketAddress destinationAddress = InetSocketAddress (Ipv4Address (oss.str().c_str ()), port); // destination address for sorce apps
-      InetSocketAddress sinkReceivingAddress = InetSocketAddress (Ipv4Address::GetAny (), port); // sink nodes receive from any address
       double appJitter = var->GetValue (0.0,0.5); // half of a second jitter
-    
-      // Source
-      StatsSourceHelper sourceAppH (transportProtocolFactory, destinationAddress);
-      sourceAppH.SetConstantRate (DataRate (rate));
-      sourceAppH.SetAttribute ("PacketSize", UintegerValue(packetSize));
-      ApplicationContainer sourceApps = sourceAppH.Install (vehicles.Get (p));
-      sourceApps.Start (Seconds (netStartupTime+appJitter));
-      sourceApps.Stop (Seconds (netStartupTime+simulationTime+appJitter)); // Every app stops after finishes runnig of "simulationTime" seconds
-    
-      // Sink 
-      StatsSinkHelper sink (transportProtocolFactory, sinkReceivingAddress);
-      ApplicationContainer sinkApps = sink.Install (vehicles.Get (q));
-      sinkApps.Start (Seconds (0.0)); // start at the begining and wait for first packet
-      sinkApps.Stop (Seconds (netStartupTime+simulationTime)); // stop a bit later then source to receive the last packet
+      AppFlow flow = { p, q, appJitter };
+      flows.push_back (flow);
     }
+
+  // Installs applications; start and stop times are relative to the time of installation,
+  // so "startupTime" is the time when the network starts carrying application traffic
+  auto installApplications = [&, transportProtocolFactory, port] (double startupTime)
+    {
+      for (std::vector<AppFlow>::const_iterator f = flows.begin (); f != flows.end (); ++f)
+        {
+          std::ostringstream oss;
+          oss <<  "10.1.0." << f->sink+1; //destination address
+          InetSocketAddress destinationAddress = InetSocketAddress (Ipv4Address (oss.str().c_str ()), port); // destination address for sorce apps
+          InetSocketAddress sinkReceivingAddress = InetSocketAddress (Ipv4Address::GetAny (), port); // sink nodes receive from any address
+
+          // Source
+          StatsSourceHelper sourceAppH (transportProtocolFactory, destinationAddress);
+          sourceAppH.SetConstantRate (DataRate (m_rate));
+          sourceAppH.SetAttribute ("PacketSize", UintegerValue(m_packetSize));
+          ApplicationContainer sourceApps = sourceAppH.Install (vehicles.Get (f->source));
+          sourceApps.Start (Seconds (startupTime+f->jitter));
+          sourceApps.Stop (Seconds (startupTime+m_simulationTime+f->jitter)); // Every app stops after finishes runnig of "simulationTime" seconds
+
+          // Sink
+          StatsSinkHelper sink (transportProtocolFactory, sinkReceivingAddress);
+          ApplicationContainer sinkApps = sink.Install (vehicles.Get (f->sink));
+          sinkApps.Start (Seconds (0.0)); // start at the begining and wait for first packet
+          sinkApps.Stop (Seconds (startupTime+m_simulationTime)); // stop a bit later then source to receive the last packet
+        }
+    };
  
   //---------------------------------------------
   // Tracing configuration
@@ -709,10 +1263,13 @@ RoutingExperiment::Run (int argc, char **argv)
   flowMonitor = flowHelper.InstallAll();  */
 
   // NPAF configuration
-  // File name
-  m_csvFileNamePrefix += "-Sc_" + sc + "-Loss_" + lm + "-Rout_" + rp + "-Tr_" + tp + "-" + std::to_string (nSources) + "of" + std::to_string (nNodes)
-                      + "-" + rate + "-" + std::to_string (packetSize) + "B";
-  StatsFlows oneRunStats (m_rngRun, m_csvFileNamePrefix, false, false); // current RngRun, file name, RunSummary to file, EveryPacket to file
+  // File name (m_csvFileName) is set by Configure ()
+  std::unique_ptr<StatsFlows> oneRunStats;
+  if (!m_warmupDetection)
+    {
+      installApplications (m_netStartupTime);
+      oneRunStats.reset (new StatsFlows (m_rngRun, m_csvFileName, false, false)); // current RngRun, file name, RunSummary to file, EveryPacket to file
+    }
   //StatsFlows oneRunStats (m_rngRun, m_csvFileNamePrefix); // current RngRun, file name, false, false
   //oneRunStats.SetHistResolution (0.0001); // sets resolution in seconds
   //sf.EnableWriteEvryRunSummary (); or sf.DisableWriteEvryRunSummary (); -> file: <m_csvFileNamePrefix>-Run<RngRun>.csv
@@ -721,15 +1278,230 @@ RoutingExperiment::Run (int argc, char **argv)
   //---------------------------------------------
   // Running one simulation
   //---------------------------------------------
-  Simulator::Stop (Seconds (netStartupTime+simulationTime+1));
-  Simulator::Schedule (Seconds (0), &PrintCurrentTime);
+  Simulator::Stop (Seconds (m_netStartupTime+m_simulationTime+1));
+  // with warm-up detection, applications and statistics start in steady state, startupTime is the longest warm-up
+  WarmupDetector warmup (vehicles, m_netStartupTime, [&] ()
+    {
+      installApplications (0.0);
+      oneRunStats.reset (new StatsFlows (m_rngRun, m_csvFileName, false, false));
+      Simulator::Stop (Seconds (m_simulationTime+1));
+      m_progress.SetStopTime (Simulator::Now ().GetSeconds () + m_simulationTime + 1);
+    });
+  if (m_warmupDetection)
+    {
+      warmup.Start ();
+    }
+  if (!m_progressDir.empty ())
+    {
+      if (m_progress.Open (m_progressDir))
+        {
+          m_progress.Start (m_rngRun, m_csvFileName, m_netStartupTime + m_simulationTime + 1);
+        }
+      else
+        {
+          NS_LOG_UNCOND ("Can not make progress record in " << m_progressDir);
+        }
+    }
+  std::chrono::steady_clock::time_point loopStart = std::chrono::steady_clock::now ();
   Simulator::Run ();
-  RunSummary srs = oneRunStats.Finalize (); // Write final statistics to file and return run summary
+  m_metrics.loopTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - loopStart).count ();
+  m_metrics.setupTime = std::chrono::duration<double> (loopStart - setupStart).count ();
+  m_metrics.events = Simulator::GetEventCount ();
+  m_metrics.simTime = Simulator::Now ().GetSeconds ();
+  EventProfile *profile = ObservedScheduler::GetProfile ();
+  if (profile != 0)
+    {
+      profile->Stop (); // the stop event
+      std::string fileName = m_csvFileName + "-Run" + std::to_string (m_rngRun) + "-Profile.csv";
+      if (!profile->Write (fileName))
+        {
+          NS_LOG_UNCOND ("Can not write " << fileName);
+        }
+    }
+  m_progress.Finish ();
+  RunSummary srs = oneRunStats->Finalize (); // Write final statistics to file and return run summary
   Simulator::Destroy (); // End of simulation
+  Ipv4AddressGenerator::Reset (); // next run in this process assigns the same addresses again
+  AllocationPool::Trim (); // memory of this run goes back to malloc, the next run starts with an empty pool
+  m_metrics.cpuTime = ResourceUsage::GetCpuTime () - cpuStart;
+  m_metrics.peakRssMb = ResourceUsage::GetPeakRssMb ();
+  if (m_allocStats)
+    {
+      AllocationStats a = AllocationStats::Get () - allocStart;
+      NS_LOG_UNCOND ("Run " << m_rngRun << ": " << a.count << " allocations, " << a.bytes / 1e6 << " MB, "
+                     << a.mallocs << " from malloc");
+    }
   return srs;
 }
 
 
+//////////////////////////////////////////////
+// Simulates all runs of all experiments in worker processes
+// Every experiment writes its summary file in RngRun order, no matter which run
+// finishes first, so formulas at the end of the file cover all runs
+//////////////////////////////////////////////
+void
+RunExperiments (std::vector<RoutingExperiment> &experiments, uint32_t nWorkers, const ResultCache &cache)
+{
+  struct Job
+  {
+    size_t experiment;
+    uint64_t run;
+  };
+  std::vector<Job> jobs;
+  std::vector<uint64_t> nextRun; // next row of the summary file of every experiment
+  for (size_t e = 0; e < experiments.size (); e++)
+    {
+      for (uint64_t run = experiments[e].GetStartRngRun (); run <= experiments[e].GetStopRngRun (); run++)
+        {
+          Job job = { e, run };
+          jobs.push_back (job);
+        }
+      nextRun.push_back (experiments[e].GetStartRngRun ());
+    }
+  // longest runs first, so that the last few runs do not keep most of the workers idle
+  std::stable_sort (jobs.begin (), jobs.end (), [&experiments] (const Job &a, const Job &b)
+    {
+      return experiments[a.experiment].GetCostEstimate () > experiments[b.experiment].GetCostEstimate ();
+    });
+
+  std::vector<std::map<uint64_t, RunResult> > finished (experiments.size ()); // runs that wait for earlier runs to be written
+  std::vector<std::set<uint64_t> > failed (experiments.size ()); // runs whose worker died, waiting like finished runs
+  std::vector<bool> complete (experiments.size (), false); // no more runs are needed, the rest are skipped
+  auto write = [&] (size_t e)
+    {
+      while (!complete[e])
+        {
+          if (finished[e].count (nextRun[e]) > 0)
+            {
+              complete[e] = !experiments[e].WriteResult (finished[e][nextRun[e]]);
+              finished[e].erase (nextRun[e]);
+            }
+          else if (failed[e].count (nextRun[e]) > 0)
+            {
+              complete[e] = !experiments[e].WriteFailedRun (nextRun[e]);
+              failed[e].erase (nextRun[e]);
+            }
+          else
+            {
+              break;
+            }
+          nextRun[e]++;
+        }
+    };
+  auto deliver = [&] (size_t e, const RunResult &r)
+    {
+      if (complete[e])
+        {
+          return; // run that was already in progress when precision was reached
+        }
+      finished[e][r.rngRun] = r;
+      write (e);
+    };
+
+  // runs found in the cache are not simulated
+  std::vector<std::string> parameters;
+  for (size_t e = 0; e < experiments.size (); e++)
+    {
+      parameters.push_back (experiments[e].GetParameters ());
+    }
+  std::vector<uint64_t> ids; // farm jobs are indexes in jobs
+  for (uint64_t i = 0; i < jobs.size (); i++)
+    {
+      RunResult r;
+      if (cache.Lookup (parameters[jobs[i].experiment], jobs[i].run, r))
+        {
+          deliver (jobs[i].experiment, r);
+        }
+      else
+        {
+          ids.push_back (i);
+        }
+    }
+  if (ids.size () < jobs.size ())
+    {
+      std::cout << jobs.size () - ids.size () << " of " << jobs.size () << " runs found in the cache" << std::endl;
+    }
+
+  // traces are converted once, before workers start, all workers map the same binary file
+  for (size_t e = 0; e < experiments.size (); e++)
+    {
+      experiments[e].PrepareMobilityTrace ();
+    }
+
+  ReplicationFarm farm (nWorkers);
+  farm.Run (ids,
+            [&] (uint64_t id) { return SerializeRunResult (experiments[jobs[id].experiment].Simulate (jobs[id].run)); },
+            [&] (uint64_t id, const std::string &result)
+              {
+                size_t e = jobs[id].experiment;
+                RunResult r;
+                NS_ABORT_MSG_UNLESS (DeserializeRunResult (result, r), "Bad result of run " << jobs[id].run);
+                cache.Store (parameters[e], r);
+                deliver (e, r);
+              },
+            [&] (uint64_t id) { return complete[jobs[id].experiment]; },
+            [&] (uint64_t id, const std::string &reason)
+              {
+                size_t e = jobs[id].experiment;
+                std::cerr << "Run " << jobs[id].run << " of sweep point " << e + 1 << " failed: worker " << reason << std::endl;
+                if (!complete[e])
+                  {
+                    failed[e].insert (jobs[id].run);
+                    write (e);
+                  }
+              });
+}
+
+//////////////////////////////////////////////
+// Expands the sweep specification into one experiment per point
+//////////////////////////////////////////////
+std::vector<RoutingExperiment>
+ConfigureSweep (RoutingExperiment &defaults, int argc, char **argv)
+{
+  ParameterSweep sweep;
+  NS_ABORT_MSG_UNLESS (sweep.Load (defaults.GetSweepFile ()), "Bad sweep specification: " << sweep.GetError ());
+
+  // options that are not part of the summary file name are added to the prefix,
+  // otherwise points that differ only in them would write the same file
+  std::set<std::string> inFileName = { "csvFileNamePrefix", "scenario", "lossModel", "fading", "routingProtocol",
+                                       "nSources", "nNodes", "dataRate", "packetSize" };
+  std::vector<RoutingExperiment> experiments;
+  std::vector<std::vector<std::string> > points = sweep.GetPoints ();
+  for (std::vector<std::vector<std::string> >::const_iterator p = points.begin (); p != points.end (); ++p)
+    {
+      std::vector<std::string> args (argv, argv + argc); // command line options are defaults for every point
+      args.insert (args.end (), p->begin (), p->end ());
+      std::string prefix = defaults.GetCsvFileNamePrefix ();
+      std::vector<std::string> axes = sweep.GetAxisNames ();
+      for (std::vector<std::string>::const_iterator a = p->begin (); a != p->end (); ++a)
+        {
+          std::string name = a->substr (2, a->find ('=') - 2);
+          if (std::find (axes.begin (), axes.end (), name) != axes.end () && inFileName.count (name) == 0)
+            {
+              prefix += "-" + name + "_" + a->substr (a->find ('=') + 1);
+            }
+        }
+      args.push_back ("--csvFileNamePrefix=" + prefix);
+      if (sweep.HasRuns ())
+        {
+          args.push_back ("--startRngRun=" + std::to_string (sweep.GetStartRngRun ()));
+          args.push_back ("--stopRngRun=" + std::to_string (sweep.GetStopRngRun ()));
+        }
+      RoutingExperiment experiment;
+      experiment.Configure (args);
+      experiments.push_back (experiment);
+
+      std::cout << "Sweep point " << experiments.size () << ":";
+      for (std::vector<std::string>::const_iterator a = p->begin (); a != p->end (); ++a)
+        {
+          std::cout << " " << *a;
+        }
+      std::cout << std::endl;
+    }
+  return experiments;
+}
+
 //////////////////////////////////////////////
 // main function
 ////////////////////////////////////////////// 
@@ -737,15 +1509,36 @@ int
 main (int argc, char *argv[])
 {
   RoutingExperiment experiment;
-  auto start = std::chrono::system_clock::now();
-  RunSummary srs = experiment.Run (argc,argv);
-  auto end = std::chrono::system_clock::now();
-  std::chrono::duration<double> elapsed_seconds = end-start;
-  experiment.SetSimDuration (elapsed_seconds.count());
-  experiment.WriteToSummaryFile (srs); // -> file: <m_csvFileNamePrefix>-Summary.csv
-  return 0;
-}
-
+  experiment.Configure (argc, argv);
+  if (experiment.IsMonitor ())
+    {
+      return ProgressMonitor::Run (experiment.GetProgressDir ());
+    }
 
+  ResultCache cache (experiment.GetCacheDir (), experiment.GetCacheVersion ());
+  if (!experiment.GetSweepFile ().empty ())
+    {
+      // all points of the sweep, RngRuns are always controlled by this program
+      std::vector<RoutingExperiment> experiments = ConfigureSweep (experiment, argc, argv);
+      RunExperiments (experiments, experiment.GetNWorkers (), cache);
+      return 0;
+    }
 
+  if (experiment.IsExternalRngRunControl ())
+    {
+      // only one run, started by the script
+      RunResult r;
+      if (!cache.Lookup (experiment.GetParameters (), experiment.GetRngRun (), r))
+        {
+          experiment.PrepareMobilityTrace (); // next runs map the binary copy
+          r = experiment.Simulate (experiment.GetRngRun ());
+          cache.Store (experiment.GetParameters (), r);
+        }
+      experiment.WriteResult (r);
+      return 0;
+    }
 
+  std::vector<RoutingExperiment> experiments (1, experiment);
+  RunExperiments (experiments, experiment.GetNWorkers (), cache);
+  return 0;
+}
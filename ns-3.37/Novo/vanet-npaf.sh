@@ -1,73 +1,26 @@
 #!/bin/bash
 
-RUN_START="1"
-RUN_STOP="200"
+# Parameters of the experiment (axes, run numbers, fixed options) are in the sweep specification
+SWEEP="scratch/vanet-npaf.sweep"
 
-CURRENT_RUN_START="1"
-CURRENT_RUN_STOP="200"
-
-SLIP_BETWEEN_SIMS="10s"
-
-SIM_TIME = "500" # [s]
-STARTUP_TIME = "100" # [s]
-
-# 1=OLSR; 2=AODV; 3=DSDV; 4=DSR
-ROUTING="2"
-
-# Number of nodes
-NODES="50"
-
-# Number of source nodes - nodes that send packets
-N_SOURCE_NODES="10"
-
-# Data rate: 1kbps - controll traffic, 10kbps - high controll traffic, 1000kbps - video traffic
-RATES="4kbps"
-
-# Size of packets (payload size) in bytes: 64B for small controll packets, 2048B for large video packets
-PACKET_SIZE="512"
-
-# Scenario: 0 = Random Waypoint model, 1 = Manhattan Grid from NS-2 trace (ns2Trace-<broj cvorova>.txt), 2 = MG 2x2km semafor 1 lane
-SCENARIO=2
+# Number of worker processes that simulate runs in parallel (0 = one per CPU core)
+WORKERS="0"
 
 # Name of the script (.cc file in the scratch folder) - use different files for different scenarios
 PROGRAM_NAME="vanet-npaf"
 
 echo Experiment starts...
-
-for r in $ROUTING
-do
-  for node in $NODES
-  do
-    for source in $N_SOURCE_NODES
-    do
-      for rate in $RATES
-      do
-        for (( run=$CURRENT_RUN_START; run<=$CURRENT_RUN_STOP; run++ ))
-        do
-          echo 
-          echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
-          echo x   Run = $run
-          echo x   "./ns3 run \"$PROGRAM_NAME --scenario=$SCENARIO --routingProtocol=$r (protocol: 1=OLSR; 2=AODV; 3=DSDV; 4=DSR)"
-          echo x   "      --nNodes=$node --nSources=$source --dataRate=$rate --packetSize=$PACKET_SIZE"
-          echo x   "      --startRngRun=$RUN_START --currentRngRun=$run --stopRngRun=$RUN_STOP --simTime=$SIM_TIME\""
-          echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
-          echo 
-          echo "Start time:"
-
-          date
-          ./ns3 run "$PROGRAM_NAME --scenario=$SCENARIO --routingProtocol=$r --nNodes=$node --nSources=$source --dataRate=$rate --packetSize=$PACKET_SIZE --startRngRun=$RUN_START --currentRngRun=$run --stopRngRun=$RUN_STOP --simTime=$SIM_TIME" 
-          echo "StopTime:"
-          date
-          
-          echo --------------------------------------------------------------------------
-          
-          spd-say "End of run $run."
-
-          echo Sleeping now for $SLIP_BETWEEN_SIMS...
-          sleep $SLIP_BETWEEN_SIMS
-        done
-      done
-    done
-  done  
-done
-
+echo 
+echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+echo x   "./ns3 run \"$PROGRAM_NAME --sweep=$SWEEP --workers=$WORKERS\""
+echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+echo 
+echo "Start time:"
+date
+# all points of the sweep and all their runs are simulated by one program, spread over worker processes
+./ns3 run "$PROGRAM_NAME --sweep=$SWEEP --workers=$WORKERS"
+echo "StopTime:"
+date
+echo --------------------------------------------------------------------------
+
+spd-say "End of the sweep $SWEEP."